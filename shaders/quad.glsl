@@ -0,0 +1,78 @@
+// every quad program is a permutation of this file. the features come in as
+// defines (TEXTURED, VERTEX_COLOR, PROJECTION, ALPHA_TEST, INSTANCING) and
+// VERTEX_SHADER or FRAGMENT_SHADER selects the stage, the #version line is
+// added in front of them by the gamespace
+
+#ifdef VERTEX_SHADER
+layout (location = 0) in vec2 position;
+
+#ifdef VERTEX_COLOR
+layout (location = 1) in vec4 color;
+out vec4 vertcolor;
+#endif
+
+#ifdef TEXTURED
+layout (location = 2) in vec2 uv;
+out vec2 vertuv;
+#endif
+
+#ifdef INSTANCING
+// xy offset and zw scale of the instance
+layout (location = 3) in vec4 instance;
+#endif
+
+#ifdef PROJECTION
+uniform mat4 projection;
+#endif
+
+void main(){
+    vec2 world = position;
+#ifdef INSTANCING
+    world = world * instance.zw + instance.xy;
+#endif
+
+#ifdef PROJECTION
+    gl_Position = projection * vec4(world, 0.0, 1.0);
+#else
+    gl_Position = vec4(world, 0.0, 1.0);
+#endif
+
+#ifdef VERTEX_COLOR
+    vertcolor = color;
+#endif
+#ifdef TEXTURED
+    vertuv = uv;
+#endif
+}
+#endif
+
+
+#ifdef FRAGMENT_SHADER
+out vec4 fragcolor;
+
+#ifdef VERTEX_COLOR
+in vec4 vertcolor;
+#endif
+
+#ifdef TEXTURED
+in vec2 vertuv;
+uniform sampler2D spriteTexture;
+#endif
+
+// fragments below this alpha are dropped instead of blended
+#define ALPHA_CUTOFF 0.5
+
+void main(){
+    vec4 result = vec4(1.0);
+#ifdef VERTEX_COLOR
+    result *= vertcolor;
+#endif
+#ifdef TEXTURED
+    result *= texture(spriteTexture, vertuv);
+#endif
+#ifdef ALPHA_TEST
+    if (result.a < ALPHA_CUTOFF) discard;
+#endif
+    fragcolor = result;
+}
+#endif
@@ -0,0 +1,252 @@
+#include "atlas.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+int atlas_add_sheet(TextureAtlas * atlas, const unsigned char * pixels, unsigned int width, unsigned int height, unsigned int x_max, unsigned int y_max){
+    if (atlas->sheet_count == ATLAS_MAX_SHEETS){
+        printf("atlas :: out of sheets\n");
+        return -1;
+    }
+    if (atlas->cell_count + x_max * y_max > ATLAS_MAX_CELLS){
+        printf("atlas :: out of cells\n");
+        return -1;
+    }
+
+    AtlasSheet * sheet = atlas->sheets + atlas->sheet_count;
+    *sheet = {};
+    sheet->pixels = pixels;
+    sheet->width = width;
+    sheet->height = height;
+    sheet->x_max = x_max;
+    sheet->y_max = y_max;
+    sheet->first_cell = atlas->cell_count;
+
+    atlas->cell_count += x_max * y_max;
+    atlas->sheet_count += 1;
+    return atlas->sheet_count - 1;
+}
+
+int atlas_add_sheet_regions(TextureAtlas * atlas, const unsigned char * pixels, unsigned int width, unsigned int height, const AtlasRegion * regions, unsigned int region_count){
+    for(unsigned int r = 0 ; r < region_count ; r++){
+        if (regions[r].x + regions[r].width > width || regions[r].y + regions[r].height > height){
+            printf("atlas :: region %u lies outside the %ux%u image\n", r, width, height);
+            return -1;
+        }
+    }
+    int sheet = atlas_add_sheet(atlas, pixels, width, height, region_count, 1);
+    if (sheet != -1) atlas->sheets[sheet].regions = regions;
+    return sheet;
+}
+
+// value of attribute name inside [begin, end), 0 when it is missing
+static unsigned int xml_attribute(const char * begin, const char * end, const char * name){
+    size_t length = strlen(name);
+    for(const char * c = begin + 1 ; c + length + 2 < end ; c++){
+        // the attribute has to start after whitespace, "y" must not match "height"
+        if (c[-1] != ' ' && c[-1] != '\t' && c[-1] != '\n') continue;
+        if (strncmp(c, name, length) == 0 && c[length] == '=' && c[length + 1] == '"'){
+            return (unsigned int) strtoul(c + length + 2, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+int atlas_load_kenney_xml(const char * filepath, AtlasRegion * regions, unsigned int max_regions){
+    FILE * file = fopen(filepath, "rb");
+    if (file == nullptr) return -1;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char * buffer = (char *) malloc(size + 1);
+    size_t read = fread(buffer, 1, size, file);
+    buffer[read] = 0;
+    fclose(file);
+
+    unsigned int count = 0;
+    const char * element = buffer;
+    while((element = strstr(element, "<SubTexture")) != nullptr && count < max_regions){
+        const char * end = strstr(element, "/>");
+        if (end == nullptr) break;
+
+        AtlasRegion * region = regions + count;
+        region->x      = xml_attribute(element, end, "x");
+        region->y      = xml_attribute(element, end, "y");
+        region->width  = xml_attribute(element, end, "width");
+        region->height = xml_attribute(element, end, "height");
+        if (region->width != 0 && region->height != 0) count += 1;
+
+        element = end;
+    }
+
+    free(buffer);
+    return count;
+}
+
+// height of the skyline under [x, x + width) starting at node index, -1 when
+// the rect does not fit there
+static int skyline_fit(const TextureAtlas * atlas, unsigned int index, unsigned int width, unsigned int height, unsigned int * y_out){
+    const SkylineNode * nodes = atlas->nodes;
+    if (nodes[index].x + width > atlas->width) return -1;
+
+    unsigned int y = 0;
+    unsigned int remaining = width;
+    for(unsigned int i = index ; remaining > 0 ; i++){
+        if (i == atlas->node_count) return -1;
+        if (nodes[i].y > y) y = nodes[i].y;
+        if (y + height > atlas->height) return -1;
+        remaining -= nodes[i].width < remaining ? nodes[i].width : remaining;
+    }
+    *y_out = y;
+    return 0;
+}
+
+static void skyline_remove(TextureAtlas * atlas, unsigned int index){
+    memmove(atlas->nodes + index, atlas->nodes + index + 1, (atlas->node_count - index - 1) * sizeof(SkylineNode));
+    atlas->node_count -= 1;
+}
+
+static int skyline_insert(TextureAtlas * atlas, unsigned int width, unsigned int height, unsigned int * x_out, unsigned int * y_out){
+    SkylineNode * nodes = atlas->nodes;
+
+    // bottom left : lowest resulting top edge, ties go to the narrower node
+    int best_index = -1;
+    unsigned int best_y = UINT_MAX;
+    unsigned int best_width = UINT_MAX;
+    for(unsigned int i = 0 ; i < atlas->node_count ; i++){
+        unsigned int y;
+        if (skyline_fit(atlas, i, width, height, &y)) continue;
+        if (y < best_y || (y == best_y && nodes[i].width < best_width)){
+            best_index = i;
+            best_y = y;
+            best_width = nodes[i].width;
+        }
+    }
+    if (best_index == -1 || atlas->node_count == ATLAS_MAX_NODES) return -1;
+
+    unsigned int index = best_index;
+    memmove(nodes + index + 1, nodes + index, (atlas->node_count - index) * sizeof(SkylineNode));
+    atlas->node_count += 1;
+    nodes[index].y = best_y + height;
+    nodes[index].width = width;
+
+    // the new node shadows the start of the skyline to its right
+    for(unsigned int i = index + 1 ; i < atlas->node_count ; ){
+        unsigned int end = nodes[i - 1].x + nodes[i - 1].width;
+        if (nodes[i].x >= end) break;
+
+        unsigned int shrink = end - nodes[i].x;
+        if (nodes[i].width <= shrink){
+            skyline_remove(atlas, i);
+            continue;
+        }
+        nodes[i].x += shrink;
+        nodes[i].width -= shrink;
+        break;
+    }
+
+    for(unsigned int i = 0 ; i + 1 < atlas->node_count ; ){
+        if (nodes[i].y == nodes[i + 1].y){
+            nodes[i].width += nodes[i + 1].width;
+            skyline_remove(atlas, i + 1);
+        } else {
+            i++;
+        }
+    }
+
+    *x_out = nodes[index].x;
+    *y_out = best_y;
+    return 0;
+}
+
+static int atlas_try_pack(TextureAtlas * atlas, const unsigned int * order){
+    atlas->nodes[0] = { 0, 0, atlas->width };
+    atlas->node_count = 1;
+
+    for(unsigned int i = 0 ; i < atlas->sheet_count ; i++){
+        AtlasSheet * sheet = atlas->sheets + order[i];
+        unsigned int x, y;
+        if (skyline_insert(atlas, sheet->width + 2 * ATLAS_PADDING, sheet->height + 2 * ATLAS_PADDING, &x, &y)) return -1;
+        sheet->x = x + ATLAS_PADDING;
+        sheet->y = y + ATLAS_PADDING;
+    }
+    return 0;
+}
+
+int atlas_pack(TextureAtlas * atlas, unsigned int max_size){
+    // taller sheets first, the skyline wastes less space that way
+    unsigned int order[ATLAS_MAX_SHEETS];
+    for(unsigned int i = 0 ; i < atlas->sheet_count ; i++){
+        unsigned int j = i;
+        for( ; j > 0 && atlas->sheets[order[j - 1]].height < atlas->sheets[i].height ; j--){
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    unsigned int size = 256;
+    for( ; size <= max_size ; size *= 2){
+        atlas->width = size;
+        atlas->height = size;
+        if (atlas_try_pack(atlas, order) == 0) break;
+    }
+    if (size > max_size){
+        printf("atlas :: sheets do not fit in %ux%u\n", max_size, max_size);
+        return -1;
+    }
+
+    glm::vec2 texel = glm::vec2(1.0f / atlas->width, 1.0f / atlas->height);
+    for(unsigned int s = 0 ; s < atlas->sheet_count ; s++){
+        AtlasSheet * sheet = atlas->sheets + s;
+        sheet->rect.uv_pos = glm::vec2(sheet->x, sheet->y) * texel;
+        sheet->rect.uv_dim = glm::vec2(sheet->width, sheet->height) * texel;
+
+        if (sheet->regions){
+            // the image is flipped on load so the region rows count from the bottom
+            for(unsigned int r = 0 ; r < sheet->x_max ; r++){
+                const AtlasRegion * region = sheet->regions + r;
+                AtlasRect * cell = atlas->cells + sheet->first_cell + r;
+                cell->uv_pos = glm::vec2(sheet->x + region->x, sheet->y + sheet->height - region->y - region->height) * texel;
+                cell->uv_dim = glm::vec2(region->width, region->height) * texel;
+            }
+            sheet->regions = nullptr;
+            continue;
+        }
+
+        glm::vec2 cell_dim = sheet->rect.uv_dim / glm::vec2(sheet->x_max, sheet->y_max);
+        for(unsigned int y = 0 ; y < sheet->y_max ; y++){
+            for(unsigned int x = 0 ; x < sheet->x_max ; x++){
+                AtlasRect * cell = atlas->cells + sheet->first_cell + x + y * sheet->x_max;
+                cell->uv_pos = sheet->rect.uv_pos + glm::vec2(x, y) * cell_dim;
+                cell->uv_dim = cell_dim;
+            }
+        }
+    }
+    return 0;
+}
+
+void atlas_write_pixels(const TextureAtlas * atlas, unsigned char * pixels){
+    memset(pixels, 0, (size_t) atlas->width * atlas->height * 4);
+
+    for(unsigned int s = 0 ; s < atlas->sheet_count ; s++){
+        const AtlasSheet * sheet = atlas->sheets + s;
+        int width = sheet->width;
+        int height = sheet->height;
+
+        for(int y = -ATLAS_PADDING ; y < height + ATLAS_PADDING ; y++){
+            int src_y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+            unsigned char * dst = pixels + ((size_t) (sheet->y + y) * atlas->width + sheet->x) * 4;
+            const unsigned char * src = sheet->pixels + (size_t) src_y * width * 4;
+
+            memcpy(dst, src, (size_t) width * 4);
+            for(int x = 1 ; x <= ATLAS_PADDING ; x++){
+                memcpy(dst - x * 4, src, 4);
+                memcpy(dst + (width - 1 + x) * 4, src + (width - 1) * 4, 4);
+            }
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef ATLAS_HH
+#define ATLAS_HH
+
+#include <glm/glm.hpp>
+
+// Texture atlas, sprite sheets and loose images are packed into one rgba8 
+// image at load time with a skyline bottom-left packer. a sheet is either a 
+// grid of x_max * y_max cells (a loose image is a 1x1 sheet) or a list of 
+// pixel regions read from metadata, every cell gets an entry in the remap 
+// table so (sheet, cell) -> uv is one indexed load and tiles of different 
+// sheets can share a single draw
+
+#define ATLAS_MAX_SHEETS    32
+#define ATLAS_MAX_CELLS     4096
+#define ATLAS_MAX_NODES     256
+
+// border around every sheet in pixels, the edge texels are extruded into it
+// so linear filtering never picks up the neighbouring sheet
+#define ATLAS_PADDING       1
+
+struct AtlasRect {
+    glm::vec2 uv_pos;
+    glm::vec2 uv_dim;
+};
+
+// sub image in pixels, the origin is the top left corner of the source image
+// as in the kenney xml metadata
+struct AtlasRegion {
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+    unsigned int height;
+};
+
+struct AtlasSheet {
+    // rgba8, owned by the caller and only read by atlas_write_pixels
+    const unsigned char * pixels;
+    unsigned int width;
+    unsigned int height;
+
+    unsigned int x_max;
+    unsigned int y_max;
+
+    // x_max regions in a single row when the sheet is not an even grid, owned
+    // by the caller until atlas_pack
+    const AtlasRegion * regions;
+
+    // filled by atlas_pack
+    unsigned int x;
+    unsigned int y;
+    unsigned int first_cell;
+    AtlasRect    rect;
+};
+
+struct SkylineNode {
+    unsigned int x;
+    unsigned int y;
+    unsigned int width;
+};
+
+struct TextureAtlas {
+    unsigned int width;
+    unsigned int height;
+
+    AtlasSheet sheets[ATLAS_MAX_SHEETS];
+    unsigned int sheet_count;
+
+    AtlasRect cells[ATLAS_MAX_CELLS];
+    unsigned int cell_count;
+
+    SkylineNode nodes[ATLAS_MAX_NODES];
+    unsigned int node_count;
+};
+
+// returns the sheet index or -1 when the atlas is out of sheets / cells
+int atlas_add_sheet(TextureAtlas * atlas, const unsigned char * pixels, unsigned int width, unsigned int height, unsigned int x_max, unsigned int y_max);
+
+// sheet split into arbitrary regions, returns the sheet index or -1
+int atlas_add_sheet_regions(TextureAtlas * atlas, const unsigned char * pixels, unsigned int width, unsigned int height, const AtlasRegion * regions, unsigned int region_count);
+
+// reads the SubTexture entries of a kenney style xml atlas description,
+// returns the number of regions written or -1 when the file can not be read
+int atlas_load_kenney_xml(const char * filepath, AtlasRegion * regions, unsigned int max_regions);
+
+// picks the smallest power of two size up to max_size that fits every sheet 
+// and fills the remap table, returns -1 when they do not fit
+int atlas_pack(TextureAtlas * atlas, unsigned int max_size);
+
+// copies every sheet into pixels (width * height * 4 bytes)
+void atlas_write_pixels(const TextureAtlas * atlas, unsigned char * pixels);
+
+inline const AtlasRect & atlas_cell(const TextureAtlas * atlas, unsigned int sheet, unsigned int cell){
+    return atlas->cells[atlas->sheets[sheet].first_cell + cell];
+}
+
+#endif
@@ -0,0 +1,362 @@
+#ifndef CONTAINERS_HH
+#define CONTAINERS_HH
+
+#include <cstdint>
+#include <cstring>
+
+#include "memory.hh"
+
+// @note: containers that take their memory from a MemoryArena or a
+//        MemoryStackAllocator instead of the system heap. nothing is ever
+//        given back, storage left behind when a container grows stays in
+//        the allocator until it is reset, and a container on a stack must
+//        not outlive the marker or frame it was created under. elements are
+//        copied around with plain assignment, they are meant to be POD
+
+// where a container gets its memory from, a zeroed allocator has no memory
+// and only containers with inline storage work with it
+struct ContainerAllocator {
+    MemoryArena * arena;
+    MemoryStackAllocator * stack;
+};
+
+inline ContainerAllocator container_allocator(MemoryArena * arena){
+    return { arena, nullptr };
+}
+
+inline ContainerAllocator container_allocator(MemoryStackAllocator * stack){
+    return { nullptr, stack };
+}
+
+inline void * container_push(ContainerAllocator allocator, size_t size, size_t alignment){
+    if (allocator.arena) return push_value_to_arena(allocator.arena, size, alignment);
+    if (allocator.stack) return push_in_stack(allocator.stack, size, alignment);
+    return nullptr;
+}
+
+// grows a block in place when it is the newest allocation, guard bands
+// always sit after the block so with BREAD_MEMORY_GUARDS this never succeeds
+inline bool container_extend(ContainerAllocator allocator, void * block, size_t size, size_t new_size){
+    char * end = (char *) block + size;
+    if (allocator.arena){
+        if ((char *) allocator.arena->ptr + allocator.arena->cur != end) return false;
+        return push_value_to_arena(allocator.arena, new_size - size, 1) == end;
+    }
+    if (allocator.stack){
+        if ((char *) allocator.stack->base + allocator.stack->used != end) return false;
+        return push_in_stack(allocator.stack, new_size - size, 1) == end;
+    }
+    return false;
+}
+
+#define CONTAINER_MIN_CAPACITY  8
+
+
+// Fixed array
+
+template <typename T>
+struct FixedArray {
+    T * items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+template <typename T>
+int init_fixed_array(FixedArray<T> * array, ContainerAllocator allocator, uint32_t capacity){
+    *array = {};
+    array->items = (T *) container_push(allocator, sizeof(T) * capacity, alignof(T));
+    if (array->items == nullptr) return -1;
+    array->capacity = capacity;
+    return 0;
+}
+
+// nullptr when the array is full
+template <typename T>
+T * fixed_array_push(FixedArray<T> * array, const T & value){
+    if (array->count == array->capacity) return nullptr;
+    T * item = array->items + array->count;
+    *item = value;
+    array->count += 1;
+    return item;
+}
+
+// the last item moves into the removed place
+template <typename T>
+void fixed_array_remove(FixedArray<T> * array, uint32_t index){
+    array->count -= 1;
+    if (index != array->count) array->items[index] = array->items[array->count];
+}
+
+
+// Growable array
+
+template <typename T>
+struct Array {
+    T * items;
+    uint32_t count;
+    uint32_t capacity;
+    ContainerAllocator allocator;
+};
+
+template <typename T>
+void init_array(Array<T> * array, ContainerAllocator allocator){
+    *array = {};
+    array->allocator = allocator;
+}
+
+// extends the storage in place when nothing was allocated after it,
+// otherwise the items are copied to a new block
+template <typename T>
+int array_reserve(Array<T> * array, uint32_t capacity){
+    if (capacity <= array->capacity) return 0;
+
+    if (array->items && container_extend(array->allocator, array->items, sizeof(T) * array->capacity, sizeof(T) * capacity)){
+        array->capacity = capacity;
+        return 0;
+    }
+
+    T * items = (T *) container_push(array->allocator, sizeof(T) * capacity, alignof(T));
+    if (items == nullptr) return -1;
+    if (array->count) memcpy(items, array->items, sizeof(T) * array->count);
+    array->items = items;
+    array->capacity = capacity;
+    return 0;
+}
+
+// nullptr when the allocator is out of memory
+template <typename T>
+T * array_push(Array<T> * array, const T & value){
+    if (array->count == array->capacity){
+        uint32_t capacity = array->capacity ? array->capacity * 2 : CONTAINER_MIN_CAPACITY;
+        if (array_reserve(array, capacity)) return nullptr;
+    }
+    T * item = array->items + array->count;
+    *item = value;
+    array->count += 1;
+    return item;
+}
+
+// the last item moves into the removed place
+template <typename T>
+void array_remove(Array<T> * array, uint32_t index){
+    array->count -= 1;
+    if (index != array->count) array->items[index] = array->items[array->count];
+}
+
+template <typename T>
+void array_clear(Array<T> * array){
+    array->count = 0;
+}
+
+
+// Small vector
+
+// @note: the first N items live inside the struct, the vector only goes to
+//        its allocator once it grows past them. a copy of a vector that has
+//        spilled shares the spilled items with the original
+template <typename T, uint32_t N>
+struct SmallVector {
+    T * spilled;
+    uint32_t count;
+    uint32_t capacity;
+    ContainerAllocator allocator;
+    T inline_items[N];
+};
+
+template <typename T, uint32_t N>
+void init_small_vector(SmallVector<T, N> * vector, ContainerAllocator allocator = {}){
+    vector->spilled = nullptr;
+    vector->count = 0;
+    vector->capacity = N;
+    vector->allocator = allocator;
+}
+
+template <typename T, uint32_t N>
+T * small_vector_items(SmallVector<T, N> * vector){
+    return vector->spilled ? vector->spilled : vector->inline_items;
+}
+
+template <typename T, uint32_t N>
+const T * small_vector_items(const SmallVector<T, N> * vector){
+    return vector->spilled ? vector->spilled : vector->inline_items;
+}
+
+// nullptr when the inline items are used up and the allocator is out of
+// memory, or there is no allocator
+template <typename T, uint32_t N>
+T * small_vector_push(SmallVector<T, N> * vector, const T & value){
+    if (vector->count == vector->capacity){
+        uint32_t capacity = vector->capacity * 2;
+        T * items = small_vector_items(vector);
+        if (vector->spilled && container_extend(vector->allocator, items, sizeof(T) * vector->capacity, sizeof(T) * capacity)){
+            vector->capacity = capacity;
+        } else {
+            T * spilled = (T *) container_push(vector->allocator, sizeof(T) * capacity, alignof(T));
+            if (spilled == nullptr) return nullptr;
+            memcpy(spilled, items, sizeof(T) * vector->count);
+            vector->spilled = spilled;
+            vector->capacity = capacity;
+        }
+    }
+    T * item = small_vector_items(vector) + vector->count;
+    *item = value;
+    vector->count += 1;
+    return item;
+}
+
+template <typename T, uint32_t N>
+void small_vector_clear(SmallVector<T, N> * vector){
+    vector->count = 0;
+}
+
+
+// Hash map
+
+// FNV-1a over the bytes of the key, keys with padding bytes need their own
+// hash function
+inline uint64_t container_hash_bytes(const void * data, size_t size){
+    const unsigned char * bytes = (const unsigned char *) data;
+    uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0 ; i < size ; i++){
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename K>
+struct ContainerHash {
+    uint64_t operator () (const K & key) const {
+        return container_hash_bytes(&key, sizeof(K));
+    }
+};
+
+// @note: open addressing with linear probing over a power of two number of
+//        slots, kept at most three quarters full. keys are compared with ==.
+//        removal shifts the following entries back instead of leaving
+//        tombstones, so lookups never walk past deleted entries. iterate by
+//        going over [0, capacity) and skipping slots that are not used
+template <typename K, typename V, typename Hash = ContainerHash<K>>
+struct HashMap {
+    K * keys;
+    V * values;
+    uint8_t * used;
+
+    uint32_t capacity;
+    uint32_t count;
+    ContainerAllocator allocator;
+};
+
+template <typename K, typename V, typename Hash>
+int hash_map_allocate(HashMap<K, V, Hash> * map, uint32_t capacity){
+    K * keys        = (K *) container_push(map->allocator, sizeof(K) * capacity, alignof(K));
+    V * values      = (V *) container_push(map->allocator, sizeof(V) * capacity, alignof(V));
+    uint8_t * used  = (uint8_t *) container_push(map->allocator, capacity, 1);
+    if (keys == nullptr || values == nullptr || used == nullptr) return -1;
+
+    memset(used, 0, capacity);
+    map->keys = keys;
+    map->values = values;
+    map->used = used;
+    map->capacity = capacity;
+    map->count = 0;
+    return 0;
+}
+
+// sized so that `expected` entries fit without growing
+template <typename K, typename V, typename Hash>
+int init_hash_map(HashMap<K, V, Hash> * map, ContainerAllocator allocator, uint32_t expected = 0){
+    *map = {};
+    map->allocator = allocator;
+    uint32_t capacity = CONTAINER_MIN_CAPACITY;
+    while(capacity / 4 * 3 < expected) capacity *= 2;
+    return hash_map_allocate(map, capacity);
+}
+
+// slot holding the key, or the empty slot where it would go
+template <typename K, typename V, typename Hash>
+uint32_t hash_map_slot(const HashMap<K, V, Hash> * map, const K & key){
+    uint32_t mask = map->capacity - 1;
+    uint32_t slot = (uint32_t) Hash()(key) & mask;
+    while(map->used[slot] && !(map->keys[slot] == key)){
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+template <typename K, typename V, typename Hash>
+V * hash_map_get(HashMap<K, V, Hash> * map, const K & key){
+    if (map->capacity == 0) return nullptr;
+    uint32_t slot = hash_map_slot(map, key);
+    return map->used[slot] ? map->values + slot : nullptr;
+}
+
+// doubles the slots and reinserts every entry, the old slots stay behind
+// in the allocator
+template <typename K, typename V, typename Hash>
+int hash_map_grow(HashMap<K, V, Hash> * map){
+    HashMap<K, V, Hash> old = *map;
+    if (hash_map_allocate(map, old.capacity ? old.capacity * 2 : CONTAINER_MIN_CAPACITY)){
+        *map = old;
+        return -1;
+    }
+    for(uint32_t i = 0 ; i < old.capacity ; i++){
+        if (old.used[i] == 0) continue;
+        uint32_t slot = hash_map_slot(map, old.keys[i]);
+        map->keys[slot] = old.keys[i];
+        map->values[slot] = old.values[i];
+        map->used[slot] = 1;
+    }
+    map->count = old.count;
+    return 0;
+}
+
+// inserts the key or overwrites its value, nullptr when the map had to grow
+// and the allocator is out of memory
+template <typename K, typename V, typename Hash>
+V * hash_map_put(HashMap<K, V, Hash> * map, const K & key, const V & value){
+    if ((map->count + 1) * 4 > map->capacity * 3){
+        if (hash_map_get(map, key) == nullptr && hash_map_grow(map)) return nullptr;
+    }
+    uint32_t slot = hash_map_slot(map, key);
+    if (map->used[slot] == 0){
+        map->keys[slot] = key;
+        map->used[slot] = 1;
+        map->count += 1;
+    }
+    map->values[slot] = value;
+    return map->values + slot;
+}
+
+// returns false when the key was not in the map
+template <typename K, typename V, typename Hash>
+bool hash_map_remove(HashMap<K, V, Hash> * map, const K & key){
+    if (map->capacity == 0) return false;
+    uint32_t mask = map->capacity - 1;
+    uint32_t hole = hash_map_slot(map, key);
+    if (map->used[hole] == 0) return false;
+
+    // entries after the hole move back into it unless that would put them
+    // before their home slot
+    uint32_t slot = hole;
+    while(true){
+        slot = (slot + 1) & mask;
+        if (map->used[slot] == 0) break;
+        uint32_t home = (uint32_t) Hash()(map->keys[slot]) & mask;
+        if (((slot - home) & mask) < ((slot - hole) & mask)) continue;
+        map->keys[hole] = map->keys[slot];
+        map->values[hole] = map->values[slot];
+        hole = slot;
+    }
+    map->used[hole] = 0;
+    map->count -= 1;
+    return true;
+}
+
+template <typename K, typename V, typename Hash>
+void hash_map_clear(HashMap<K, V, Hash> * map){
+    if (map->capacity) memset(map->used, 0, map->capacity);
+    map->count = 0;
+}
+
+#endif
@@ -6,6 +6,8 @@
  * It exposes 2 function 
  * - gamespace_init_function : called for initializing the game memory
  * - gamespace_update_function : called as the main game update loop
+ * - gamespace_snapshot_function / gamespace_restore_function : save and 
+ *   restore the game state between frames
  * 
  * Tasks : 
  * 1.    Basic OpenGL setup and rendering - done
@@ -57,6 +59,9 @@
 #include "gamespace.hh"
 
 #include "platform.hh"
+#include "gpu_profiler.hh"
+#include "profiler.hh"
+#include "perf_counters.hh"
 
 #include <SDL2/SDL.h>
 
@@ -71,89 +76,14 @@
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
 
-#include <stb_image.h>
-
 #include "memory.hh"
+#include "sprite_batch.hh"
+#include "quad_emitter.hh"
+#include "shader_cache.hh"
 
 
 #define QUADCOUNT 20000
 
-const char * v1 = ""
-"#version 400 core\n"
-"layout (location = 0) in vec3 position;\n\n"
-"void main(){\n"
-"   gl_Position = vec4(position, 1.0);\n"
-"}\n";
-
-
-const char * f1 = ""
-"#version 400 core\n"
-"out vec4 fragcolor;\n"
-"void main(){\n"
-"   fragcolor = vec4(0.8, 0.2, 0.3, 1.0);\n"
-"}\n";
-
-const char * v2 = ""
-"#version 400 core\n"
-"layout (location = 0) in vec2 position;\n\n"
-"layout (location = 1) in vec4 color;\n\n"
-"out vec4 vertcolor;\n"
-"void main(){\n"
-"   gl_Position = vec4(position, 0.0, 1.0);\n"
-"   vertcolor= color;\n"
-"}\n";
-
-const char * f2 = ""
-"#version 400 core\n"
-"out vec4 fragcolor;\n"
-"in  vec4 vertcolor;\n"
-"void main(){\n"
-"   fragcolor = vertcolor;\n"
-"}\n";
-
-const char * v3 = ""
-"#version 400 core\n"
-"layout (location = 0) in vec2 position;\n\n"
-"layout (location = 1) in vec4 color;\n\n"
-"out vec4 vertcolor;\n"
-"uniform mat4 projection;\n"
-"void main(){\n"
-"   gl_Position = projection * vec4(position, 0.0, 1.0);\n"
-"   vertcolor= color;\n"
-"}\n";
-
-const char * f3 = ""
-"#version 400 core\n"
-"out vec4 fragcolor;\n"
-"in  vec4 vertcolor;\n"
-"void main(){\n"
-"   fragcolor = vertcolor;\n"
-"}\n";
-
-const char * v4 = ""
-"#version 400 core\n"
-"layout (location = 0) in vec2 position;\n"
-"layout (location = 1) in vec4 color;\n"
-"layout (location = 2) in vec2 uv;\n\n"
-"out vec4 vertcolor;\n"
-"out vec2 vertuv;\n\n"
-"uniform mat4 projection;\n\n"
-"void main(){\n"
-"   gl_Position = projection * vec4(position, 0.0, 1.0);\n"
-"   vertcolor   = color;\n"
-"   vertuv      = uv;\n"
-"}\n";
-
-const char * f4 = ""
-"#version 400 core\n"
-"out vec4 fragcolor;\n"
-"in  vec4 vertcolor;\n"
-"in  vec2 vertuv;\n"
-"uniform sampler2D spriteTexture;\n"
-"void main(){\n"
-"   fragcolor = texture(spriteTexture, vertuv) * vertcolor;\n"
-"}\n";
-
 /////////// math functions  //////////////////////
 
 int clamp_int(int value, int min, int max){
@@ -195,7 +125,9 @@ T min_if_positive(T x, T y){
 
 // 
 
-int compile_shader(GameMemory * memory, char * shader_buffer, GLenum type){
+// @note: the error logs are malloced, programs are also built on the render
+//        thread (shader reloads) while the temporary stack belongs to update
+int compile_shader(char * shader_buffer, GLenum type){
     int shader_handle = glCreateShader(type);
     glShaderSource(shader_handle, 1, &shader_buffer, 0);
     glCompileShader(shader_handle);
@@ -204,20 +136,21 @@ int compile_shader(GameMemory * memory, char * shader_buffer, GLenum type){
     if (status == GL_FALSE){
         int error_log_length = 0;
         glGetShaderiv(shader_handle, GL_INFO_LOG_LENGTH, &error_log_length);
-        char * error_log = PUSH_IN_STACK(&memory->temporary, char, error_log_length + 1);
+        char * error_log = (char *) malloc(error_log_length + 1);
         glGetShaderInfoLog(shader_handle, error_log_length, &error_log_length, error_log);
         printf("shader compilation error\n");
         printf("%s\n", error_log);
         free(error_log);
         glDeleteShader(shader_handle);
         shader_handle = 0;
-        POP_FROM_STACK(&memory->temporary);
     }
     return shader_handle;
 }
 
-int link_program(GameMemory * memory, int * shader_list, int shader_count){
+int link_program(int * shader_list, int shader_count){
     GLint program = glCreateProgram();
+    // lets the driver keep the binary around for the shader cache
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     for(int i = 0; i < shader_count ; i++) glAttachShader(program, shader_list[i]);
     glLinkProgram(program);
     GLint status = 0;
@@ -226,7 +159,7 @@ int link_program(GameMemory * memory, int * shader_list, int shader_count){
     {
         int error_log_length = 0;
         glGetProgramiv(program, GL_INFO_LOG_LENGTH, &error_log_length);
-        char * error_log = PUSH_IN_STACK(&memory->temporary, char, error_log_length  + 1);
+        char * error_log = (char *) malloc(error_log_length  + 1);
         glGetProgramInfoLog(program, error_log_length, &error_log_length, error_log);
         printf("program linking failed\n");
         printf("%s\n", error_log);
@@ -234,11 +167,190 @@ int link_program(GameMemory * memory, int * shader_list, int shader_count){
         for(int i = 0; i < shader_count ; i++) glDetachShader(program, shader_list[i]);
         glDeleteProgram(program);
         program = 0;
-        POP_FROM_STACK(&memory->temporary);
     }
     return program;
 }
 
+// compiles and links the program, unless the shader cache already has a
+// binary for the same sources and driver
+GLint build_program(const char * vertex, const char * fragment){
+    uint64_t key = shader_cache_key(vertex, fragment);
+    GLint id = shader_cache_load(key);
+    if (id) return id;
+
+    int shaders[2] = {
+        compile_shader((char *) vertex, GL_VERTEX_SHADER),
+        compile_shader((char *) fragment, GL_FRAGMENT_SHADER),
+    };
+    if (shaders[0] == 0 || shaders[1] == 0){
+        if (shaders[0]) glDeleteShader(shaders[0]);
+        if (shaders[1]) glDeleteShader(shaders[1]);
+        return 0;
+    }
+
+    id = link_program(shaders, 2);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    if (id) shader_cache_store(key, id);
+    return id;
+}
+
+int create_shader_program(ShaderProgram * program, const char * vertex, const char * fragment){
+    *program = {};
+
+    GLint id = build_program(vertex, fragment);
+    if (id == 0) return -1;
+
+    program->id = id;
+    program->projection_location = glGetUniformLocation(id, "projection");
+    program->texture_location    = glGetUniformLocation(id, "spriteTexture");
+    program->projection_uploaded = false;
+
+    // the sampler always reads from texture unit 0 so it is set only once
+    if (program->texture_location != -1){
+        glUseProgram(id);
+        glUniform1i(program->texture_location, 0);
+        glUseProgram(0);
+    }
+    return 0;
+}
+
+// shaders are read from BREAD_SHADER_DIRECTORY, which is watched so that an
+// edited file gets its variants rebuilt by the render thread
+#ifndef BREAD_SHADER_DIRECTORY
+#define BREAD_SHADER_DIRECTORY "shaders"
+#endif
+
+// every quad program is a permutation of this file, see ShaderPermutations
+#define QUAD_SHADER_FILE "quad.glsl"
+
+void shader_path(const char * name, char * path, size_t size){
+    snprintf(path, size, "%s/%s", BREAD_SHADER_DIRECTORY, name);
+}
+
+// size of the file plus the null terminator, 0 when it can not be read
+size_t shader_file_size(const char * name){
+    char path[512];
+    shader_path(name, path, sizeof(path));
+    FILE * file = fopen(path, "rb");
+    if (file == nullptr){
+        printf("unable to open shader %s\n", path);
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size < 0 ? 0 : size + 1;
+}
+
+int read_shader_file(const char * name, char * buffer, size_t size){
+    char path[512];
+    shader_path(name, path, sizeof(path));
+    FILE * file = fopen(path, "rb");
+    if (file == nullptr) return -1;
+    size_t read = fread(buffer, 1, size - 1, file);
+    buffer[read] = 0;
+    fclose(file);
+    return 0;
+}
+
+// the returned buffer is malloced, it outlives the frame arenas because
+// variants keep getting built from it
+char * load_shader_source(const char * name){
+    size_t size = shader_file_size(name);
+    if (size == 0) return nullptr;
+    char * source = (char *) malloc(size);
+    if (source && read_shader_file(name, source, size)){
+        free(source);
+        source = nullptr;
+    }
+    return source;
+}
+
+struct ShaderFeatureDefine {
+    unsigned int feature;
+    const char * name;
+};
+
+static const ShaderFeatureDefine shader_feature_defines[] = {
+    { SHADER_FEATURE_TEXTURED,      "TEXTURED" },
+    { SHADER_FEATURE_VERTEX_COLOR,  "VERTEX_COLOR" },
+    { SHADER_FEATURE_PROJECTION,    "PROJECTION" },
+    { SHADER_FEATURE_ALPHA_TEST,    "ALPHA_TEST" },
+    { SHADER_FEATURE_INSTANCING,    "INSTANCING" },
+};
+
+#define SHADER_FEATURE_DEFINE_COUNT (sizeof(shader_feature_defines) / sizeof(shader_feature_defines[0]))
+
+// @note: the #version line has to come first so it is written here and not
+//        in the file, #line keeps the compiler errors pointing at the file
+char * shader_stage_source(const char * source, const char * stage, unsigned int features){
+    size_t size = strlen(source) + 512;
+    char * result = (char *) malloc(size);
+    if (result == nullptr) return nullptr;
+
+    int length = snprintf(result, size, "#version 400 core\n#define %s\n", stage);
+    for(unsigned int i = 0 ; i < SHADER_FEATURE_DEFINE_COUNT ; i++){
+        if ((features & shader_feature_defines[i].feature) == 0) continue;
+        length += snprintf(result + length, size - length, "#define %s\n", shader_feature_defines[i].name);
+    }
+    snprintf(result + length, size - length, "#line 1\n%s", source);
+    return result;
+}
+
+int create_shader_variant(ShaderProgram * program, const char * source, unsigned int features){
+    char * vertex = shader_stage_source(source, "VERTEX_SHADER", features);
+    char * fragment = shader_stage_source(source, "FRAGMENT_SHADER", features);
+    int result = -1;
+    if (vertex && fragment) result = create_shader_program(program, vertex, fragment);
+    free(vertex);
+    free(fragment);
+    return result;
+}
+
+// @note: render thread only, the first draw of a variant compiles it (or 
+//        loads it from the shader cache) so only requested variants exist
+ShaderProgram * shader_variant(ShaderPermutations * permutations, unsigned int features){
+    features &= SHADER_VARIANT_COUNT - 1;
+    ShaderProgram * program = permutations->variants + features;
+    if (program->id) return program;
+    if (permutations->source == nullptr || permutations->failed[features]) return nullptr;
+
+    if (create_shader_variant(program, permutations->source, features)){
+        printf("shader :: failed to build quad variant 0x%02x\n", features);
+        permutations->failed[features] = true;
+        return nullptr;
+    }
+    return program;
+}
+
+void use_program(RenderStateCache * cache, ShaderProgram * program){
+    if (cache->program == program->id) return;
+    glUseProgram(program->id);
+    cache->program = program->id;
+}
+
+void set_projection(ShaderProgram * program, const glm::mat4 & projection){
+    if (program->projection_location == -1) return;
+    if (program->projection_uploaded && memcmp(&program->uploaded_projection, &projection, sizeof(glm::mat4)) == 0) return;
+    glUniformMatrix4fv(program->projection_location, 1, GL_FALSE, glm::value_ptr(projection));
+    program->uploaded_projection = projection;
+    program->projection_uploaded = true;
+}
+
+void bind_texture(RenderStateCache * cache, GLuint texture){
+    if (cache->texture == texture) return;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    cache->texture = texture;
+}
+
+void bind_vertex_array(RenderStateCache * cache, GLuint vao){
+    if (cache->vao == vao) return;
+    glBindVertexArray(vao);
+    cache->vao = vao;
+}
+
 int load_plain_texture(Texture2D * texture_ref){
     GLuint texture_id;
     glGenTextures(1, &texture_id);
@@ -252,47 +364,10 @@ int load_plain_texture(Texture2D * texture_ref){
     texture_ref->width = 1;
     texture_ref->height = 1;
     texture_ref->components = 4;
+    texture_ref->state = TEXTURE_STATE_RESIDENT;
     return 0;
 }
 
-int load_texture_memory(Texture2D* texture_ref, const char * filepath)
-{
-    stbi_set_flip_vertically_on_load(true);
-    // glPixelStorei(GL_UNPACK_ALIGNMENT, 1)
-    int width, height;
-    int component;
-    // all the file loading and unloading should happen from the same function
-    unsigned char * image = stbi_load(filepath, &width, &height, &component, 0);
-
-    if (!image) {
-        printf("failed to load parse image from specified buffer\n");
-        return -1;
-    }
-    
-    GLuint texture_id;
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    if (component == 3) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    } else {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    }
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    stbi_image_free(image);
-
-    texture_ref->id= texture_id;
-    texture_ref->width = width;
-    texture_ref->height = height;
-    texture_ref->components = component;
-
-    return 0;
-}
-
-
 void init_renderer(GameMemory * memory, Renderer2D * renderer, int quad_count = QUADCOUNT){
     renderer->mem_vertex_buffer  = ALLOCATE_ARRAY(&memory->permanent, float,        quad_count * 8);
     renderer->mem_uv_coord_buffer= ALLOCATE_ARRAY(&memory->permanent, float,        quad_count * 8);
@@ -304,6 +379,9 @@ void init_renderer(GameMemory * memory, Renderer2D * renderer, int quad_count =
     renderer->total_colors = quad_count * 16;
     renderer->total_indices  = quad_count * 6;
 
+    // the null backend never draws, the buffers are only filled on the cpu
+    if (platform_is_headless()) return;
+
     glGenBuffers(1, &renderer->vbo);
     glGenBuffers(1, &renderer->ibo);
     glGenBuffers(1, &renderer->uvo);
@@ -320,6 +398,7 @@ void init_renderer(GameMemory * memory, Renderer2D * renderer, int quad_count =
 
     glGenVertexArrays(1, &renderer->vao);
     glBindVertexArray(renderer->vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->ibo);
     glBindBuffer(GL_ARRAY_BUFFER, renderer->vbo);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void *)0);
@@ -340,188 +419,415 @@ void start_rendering(Renderer2D * renderer){
 }
 
 
-void render_quad_rect_tex_rot(
-        Renderer2D * renderer,
-        glm::vec2 pos,
-        glm::vec2 dim,
-        glm::vec4 color,
-        glm::vec2 uv_pos,
-        glm::vec2 uv_dim,
-        glm::vec2 center,
-        float rot){
-    if (
-            renderer->added_vertices >= renderer->total_vertices 
-            || renderer->added_colors >= renderer->total_colors 
-            || renderer->added_indices >= renderer->total_indices
-       ){
-        printf("renderer :: buffer entirly full\n");
-        return;
-    } 
+// bulk version of render_quad<QUAD_COLORED | QUAD_TEXTURED | QUAD_ROTATED>,
+// sprites that do not fit in the remaining buffer space are dropped
+void render_sprites(Renderer2D * renderer, const SpriteBatch * batch){
+    size_t free_quads = (renderer->total_indices - renderer->added_indices) / 6;
+    unsigned int count = batch->count;
+    if (count > free_quads){
+        printf("renderer :: buffer entirly full, dropping %lu sprites\n", count - free_quads);
+        count = (unsigned int) free_quads;
+    }
 
-    glm::vec2 rect[4];
-    rect[0] = glm::vec2(pos.x, pos.y);
-    rect[1] = glm::vec2(pos.x, pos.y + dim.y);
-    rect[2] = glm::vec2(pos.x + dim.x, pos.y + dim.y);
-    rect[3] = glm::vec2(pos.x + dim.x, pos.y);
+    generate_sprite_vertices(
+            batch, 0, count,
+            renderer->mem_vertex_buffer + renderer->added_vertices,
+            renderer->mem_color_buffer + renderer->added_colors,
+            renderer->mem_uv_coord_buffer + renderer->added_uv_coords,
+            renderer->mem_index_buffer + renderer->added_indices,
+            (unsigned int) renderer->added_vertices / 2);
 
-    glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), rot, glm::vec3(0.0f, 0.0f, 1.0f));
+    reserve_quads(renderer, count);
+}
 
-    for(unsigned int i = 0; i < 4 ; i++){
-        rect[i] = center + glm::vec2(rotation_matrix *  glm::vec4((rect[i] - center), 0.0, 1.0));
+// @note: the command list always sits at the start of the frame command arena
+RenderCommandList * begin_render_commands(){
+    MemoryArena * arena = platform_render_commands();
+    RenderCommandList * list = ALLOCATE_STRUCT(arena, RenderCommandList);
+    if (list){
+        list->first = nullptr;
+        list->last  = nullptr;
     }
+    return list;
+}
 
-    glm::vec4 colors[4] = { color,color,color,color };
-    
-    glm::vec2 uv[4];
-    uv[0] = glm::vec2(uv_pos.x, uv_pos.y);
-    uv[1] = glm::vec2(uv_pos.x, uv_pos.y + uv_dim.y);
-    uv[2] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y + uv_dim.y);
-    uv[3] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y);
-
-    unsigned int indices[6] = {
-        0 + (unsigned int) renderer->added_vertices / 2, 
-        1 + (unsigned int) renderer->added_vertices / 2,
-        2 + (unsigned int) renderer->added_vertices / 2,
-        0 + (unsigned int) renderer->added_vertices / 2,
-        2 + (unsigned int) renderer->added_vertices / 2,
-        3 + (unsigned int) renderer->added_vertices / 2,
-    };
+void * push_render_command(RenderCommandList * list, unsigned int type, size_t size, size_t alignment){
+    if (list == nullptr) return nullptr;
 
+    MemoryArena * arena = platform_render_commands();
+    RenderCommand * command = ALLOCATE_STRUCT(arena, RenderCommand);
+    void * data = push_value_to_arena(arena, size, alignment);
+    if (command == nullptr || data == nullptr){
+        printf("renderer :: command arena full, dropping command\n");
+        return nullptr;
+    }
 
-    memcpy(renderer->mem_vertex_buffer + renderer->added_vertices, rect,  sizeof(float) * 2 * 4);
-    renderer->added_vertices += 2 * 4;
+    command->type = type;
+    command->next = nullptr;
+    command->data = data;
+    if (list->last) list->last->next = command;
+    else list->first = command;
+    list->last = command;
+    return data;
+}
 
-    memcpy(renderer->mem_color_buffer + renderer->added_colors, colors, sizeof(float) * 4 * 4);
-    renderer->added_colors += 4 * 4;
+template<typename T>
+T * copy_to_render_commands(const T * source, size_t count){
+    T * target = ALLOCATE_ARRAY(platform_render_commands(), T, count);
+    if (target) memcpy(target, source, sizeof(T) * count);
+    return target;
+}
 
-    memcpy(renderer->mem_uv_coord_buffer + renderer->added_uv_coords, uv, sizeof(float) * 2 * 4);
-    renderer->added_uv_coords += 2 * 4;
+// command list of the frame currently being recorded, set at the start of
+// every gamespace_update_function call
+RenderCommandList * g_render_commands = nullptr;
 
-    memcpy(renderer->mem_index_buffer + renderer->added_indices, indices, sizeof(unsigned int) * 6);
-    renderer->added_indices += 6;
+void end_rendering(Renderer2D * renderer){
+    RenderCommandUpload * upload = (RenderCommandUpload *) push_render_command(
+            g_render_commands, RENDER_COMMAND_UPLOAD, sizeof(RenderCommandUpload), alignof(RenderCommandUpload));
+    if (upload == nullptr) return;
+
+    upload->vbo = renderer->vbo;
+    upload->cbo = renderer->cbo;
+    upload->uvo = renderer->uvo;
+    upload->ibo = renderer->ibo;
+
+    upload->vertices  = copy_to_render_commands(renderer->mem_vertex_buffer, renderer->added_vertices);
+    upload->colors    = copy_to_render_commands(renderer->mem_color_buffer, renderer->added_colors);
+    upload->uv_coords = copy_to_render_commands(renderer->mem_uv_coord_buffer, renderer->added_uv_coords);
+    upload->indices   = copy_to_render_commands(renderer->mem_index_buffer, renderer->added_indices);
+
+    bool copied = (upload->vertices || !renderer->added_vertices)
+        && (upload->colors || !renderer->added_colors)
+        && (upload->uv_coords || !renderer->added_uv_coords)
+        && (upload->indices || !renderer->added_indices);
+
+    upload->vertex_count   = copied ? renderer->added_vertices : 0;
+    upload->color_count    = copied ? renderer->added_colors : 0;
+    upload->uv_coord_count = copied ? renderer->added_uv_coords : 0;
+    upload->index_count    = copied ? renderer->added_indices : 0;
 }
 
 
+// features select the quad shader variant, untextured variants take no texture
+void draw(Renderer2D * renderer, unsigned int features, const glm::mat4 & matrix, const Texture2D * texture){
+    RenderCommandDraw * command = (RenderCommandDraw *) push_render_command(
+            g_render_commands, RENDER_COMMAND_DRAW, sizeof(RenderCommandDraw), alignof(RenderCommandDraw));
+    if (command == nullptr) return;
 
-// TODO: removce the default arguments in the uv coordinates
-void render_quad_rect_tex(
-        Renderer2D * renderer, 
-        glm::vec2 pos, 
-        glm::vec2 dim, 
-        glm::vec4 color,
-        glm::vec2 uv_pos, 
-        glm::vec2 uv_dim
-        ){
-    if (
-            renderer->added_vertices >= renderer->total_vertices 
-            || renderer->added_colors >= renderer->total_colors 
-            || renderer->added_indices >= renderer->total_indices
-       ){
-        printf("renderer :: buffer entirly full\n");
-        return;
-    } 
+    command->vao = renderer->vao;
+    command->ibo = renderer->ibo;
+    command->features = features;
+    command->texture = texture;
+    command->projection = matrix;
+    command->index_count = renderer->added_indices;
+}
 
-    glm::vec2 rect[4];
-    rect[0] = glm::vec2(pos.x, pos.y);
-    rect[1] = glm::vec2(pos.x, pos.y + dim.y);
-    rect[2] = glm::vec2(pos.x + dim.x, pos.y + dim.y);
-    rect[3] = glm::vec2(pos.x + dim.x, pos.y);
+// passes are timed on the GPU, see gpu_profiler.hh for the pass ids
+void begin_gpu_pass(unsigned int pass){
+    unsigned int * data = (unsigned int *) push_render_command(
+            g_render_commands, RENDER_COMMAND_BEGIN_PASS, sizeof(unsigned int), alignof(unsigned int));
+    if (data) *data = pass;
+}
 
-    glm::vec4 colors[4] = { color,color,color,color };
-    
-    glm::vec2 uv[4];
-    uv[0] = glm::vec2(uv_pos.x, uv_pos.y);
-    uv[1] = glm::vec2(uv_pos.x, uv_pos.y + uv_dim.y);
-    uv[2] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y + uv_dim.y);
-    uv[3] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y);
-
-    unsigned int indices[6] = {
-        0 + (unsigned int) renderer->added_vertices / 2, 
-        1 + (unsigned int) renderer->added_vertices / 2,
-        2 + (unsigned int) renderer->added_vertices / 2,
-        0 + (unsigned int) renderer->added_vertices / 2,
-        2 + (unsigned int) renderer->added_vertices / 2,
-        3 + (unsigned int) renderer->added_vertices / 2,
-    };
+void end_gpu_pass(){
+    push_render_command(g_render_commands, RENDER_COMMAND_END_PASS, 0, 1);
+}
 
+// @note: uploads go through the copy write target so that binding the index
+//        buffer does not change the element binding of the cached vao
+void execute_upload_command(RenderCommandUpload * upload){
+    glBindBuffer(GL_COPY_WRITE_BUFFER, upload->vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(float) * upload->vertex_count, (void *) upload->vertices);
 
-    memcpy(renderer->mem_vertex_buffer + renderer->added_vertices, rect,  sizeof(float) * 2 * 4);
-    renderer->added_vertices += 2 * 4;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, upload->cbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(float) * upload->color_count, (void *) upload->colors);
 
-    memcpy(renderer->mem_color_buffer + renderer->added_colors, colors, sizeof(float) * 4 * 4);
-    renderer->added_colors += 4 * 4;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, upload->uvo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(float) * upload->uv_coord_count, (void *) upload->uv_coords);
 
-    memcpy(renderer->mem_uv_coord_buffer + renderer->added_uv_coords, uv, sizeof(float) * 2 * 4);
-    renderer->added_uv_coords += 2 * 4;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, upload->ibo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(unsigned int) * upload->index_count, (void *) upload->indices);
+}
 
-    memcpy(renderer->mem_index_buffer + renderer->added_indices, indices, sizeof(unsigned int) * 6);
-    renderer->added_indices += 6;
+// @note: textures that are still streaming in are drawn with the placeholder
+void execute_draw_command(GameMemory * memory, RenderCommandDraw * command){
+    RenderStateCache * cache = &memory->render_state;
+    ShaderProgram * program = shader_variant(&memory->quad_shader, command->features);
+    if (program == nullptr) return;
+
+    use_program(cache, program);
+    set_projection(program, command->projection);
+    if (command->texture){
+        const Texture2D * texture = command->texture->state == TEXTURE_STATE_RESIDENT ? command->texture : &memory->plain_texture;
+        bind_texture(cache, texture->id);
+    }
+    bind_vertex_array(cache, command->vao);
+    // the element buffer binding is part of the vao state
+    glDrawElements(GL_TRIANGLES, command->index_count, GL_UNSIGNED_INT, 0);
 }
 
-void render_quad_rect(Renderer2D * renderer, glm::vec2 pos, glm::vec2 dim, glm::vec4 color){
+// @note: the rows go through a pixel unpack buffer so the copy into the 
+//        texture can be done by the driver without stalling, the storage is
+//        orphaned on every upload instead of waiting for the previous one
+void execute_texture_upload_command(GameMemory * memory, RenderCommandTextureUpload * upload){
+    if (upload->row_count == 0) return;
+    Texture2D * texture = upload->texture;
+    RenderStateCache * cache = &memory->render_state;
+
+    if (texture->id == 0){
+        glGenTextures(1, &texture->id);
+        bind_texture(cache, texture->id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, upload->width, upload->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        texture->width = upload->width;
+        texture->height = upload->height;
+        texture->components = 4;
+    }
+    bind_texture(cache, texture->id);
+
+    if (memory->upload_pbo == 0) glGenBuffers(1, &memory->upload_pbo);
+    size_t size = (size_t) upload->width * upload->row_count * 4;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, memory->upload_pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void * target = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (target){
+        memcpy(target, upload->pixels, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload->first_row, upload->width, upload->row_count, GL_RGBA, GL_UNSIGNED_BYTE, (void *) 0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload->first_row, upload->width, upload->row_count, GL_RGBA, GL_UNSIGNED_BYTE, upload->pixels);
+    }
 
-    if (
-            renderer->added_vertices >= renderer->total_vertices 
-            || renderer->added_colors >= renderer->total_colors 
-            || renderer->added_indices >= renderer->total_indices
-       ){
-        printf("renderer; buffer entirely full\n");
+    if (upload->first_row + upload->row_count == upload->height){
+        texture->state = TEXTURE_STATE_RESIDENT;
+    }
+}
+
+// @note: the new source is copied into the command arena, the render thread
+//        rebuilds every variant built so far between draws and only swaps 
+//        them in when all of them compiled and linked
+void reload_changed_shaders(GameMemory * memory){
+    unsigned int changed_count = platform_changed_file_count();
+    if (changed_count == 0) return;
+
+    char path[512];
+    shader_path(QUAD_SHADER_FILE, path, sizeof(path));
+    bool changed = false;
+    for(unsigned int f = 0 ; f < changed_count && changed == false ; f++){
+        changed = strcmp(platform_changed_file(f), path) == 0;
+    }
+    if (changed == false) return;
+
+    size_t size = shader_file_size(QUAD_SHADER_FILE);
+    if (size == 0) return;
+
+    RenderCommandReloadShader * reload = (RenderCommandReloadShader *) push_render_command(
+            g_render_commands, RENDER_COMMAND_RELOAD_SHADER, sizeof(RenderCommandReloadShader), alignof(RenderCommandReloadShader));
+    if (reload == nullptr) return;
+
+    reload->source = ALLOCATE_ARRAY(platform_render_commands(), char, size);
+    if (reload->source == nullptr || read_shader_file(QUAD_SHADER_FILE, reload->source, size)){
+        reload->source = nullptr;
         return;
-    } 
+    }
+    printf("shader :: reloading %s\n", QUAD_SHADER_FILE);
+}
 
-    glm::vec2 rect[4];
-    rect[0] = glm::vec2(pos.x, pos.y);
-    rect[1] = glm::vec2(pos.x, pos.y + dim.y);
-    rect[2] = glm::vec2(pos.x + dim.x, pos.y + dim.y);
-    rect[3] = glm::vec2(pos.x + dim.x, pos.y);
-
-    glm::vec4 colors[4] = { color,color,color,color };
-
-    unsigned int indices[6] = {
-        0 + (unsigned int) renderer->added_vertices / 2, 
-        1 + (unsigned int) renderer->added_vertices / 2,
-        2 + (unsigned int) renderer->added_vertices / 2,
-        0 + (unsigned int) renderer->added_vertices / 2,
-        2 + (unsigned int) renderer->added_vertices / 2,
-        3 + (unsigned int) renderer->added_vertices / 2,
-    };
+void execute_reload_shader_command(GameMemory * memory, RenderCommandReloadShader * reload){
+    if (reload->source == nullptr) return;
+    ShaderPermutations * permutations = &memory->quad_shader;
 
-    memcpy(renderer->mem_vertex_buffer + renderer->added_vertices, rect,  sizeof(float) * 2 * 4);
-    renderer->added_vertices += 2 * 4;
+    // the command arena is reset every frame, the permutations keep a copy
+    char * source = (char *) malloc(strlen(reload->source) + 1);
+    if (source == nullptr) return;
+    strcpy(source, reload->source);
 
-    memcpy(renderer->mem_color_buffer + renderer->added_colors, colors, sizeof(float) * 4 * 4);
-    renderer->added_colors += 4 * 4;
+    ShaderProgram rebuilt[SHADER_VARIANT_COUNT] = {};
+    bool succeeded = true;
+    for(unsigned int i = 0 ; i < SHADER_VARIANT_COUNT && succeeded ; i++){
+        if (permutations->variants[i].id == 0) continue;
+        succeeded = create_shader_variant(rebuilt + i, source, i) == 0;
+    }
+
+    if (succeeded == false){
+        printf("shader :: reload failed, keeping the previous variants\n");
+        for(unsigned int i = 0 ; i < SHADER_VARIANT_COUNT ; i++){
+            if (rebuilt[i].id) glDeleteProgram(rebuilt[i].id);
+        }
+        free(source);
+        return;
+    }
 
-    memcpy(renderer->mem_index_buffer + renderer->added_indices, indices, sizeof(unsigned int) * 6);
-    renderer->added_indices += 6;
+    for(unsigned int i = 0 ; i < SHADER_VARIANT_COUNT ; i++){
+        if (permutations->variants[i].id) glDeleteProgram(permutations->variants[i].id);
+        permutations->variants[i] = rebuilt[i];
+        permutations->failed[i] = false;
+    }
+    free(permutations->source);
+    permutations->source = source;
+    // the cache may still name a deleted program
+    memory->render_state.program = 0;
 }
 
-void end_rendering(Renderer2D * renderer){
-    glBindBuffer(GL_ARRAY_BUFFER, renderer->vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * renderer->added_vertices, (void *) renderer->mem_vertex_buffer);
+// sprite sheets packed into the texture atlas at load time, the cells come
+// from the kenney xml metadata when it is there and from the even x_max * 
+// y_max grid otherwise
+struct SpriteSheetSource {
+    const char * filepath;
+    const char * metadata;
+    unsigned int x_max;
+    unsigned int y_max;
+};
+
+static const SpriteSheetSource sprite_sheet_sources[] = {
+    { 
+        "/home/nitesh/work/projects/active/beta-one/data/kenney_scribble-platformer/Spritesheet/spritesheet_retina.png", 
+        "/home/nitesh/work/projects/active/beta-one/data/kenney_scribble-platformer/Spritesheet/spritesheet_retina.xml", 
+        11, 11 
+    },
+};
+
+#define SPRITE_SHEET_SOURCE_COUNT (sizeof(sprite_sheet_sources) / sizeof(sprite_sheet_sources[0]))
+
+// queues the decode of every sprite sheet source, the atlas is packed and
+// uploaded by update_texture_atlas_load once all of them are done
+void begin_texture_atlas_load(GameMemory * memory){
+    TextureAtlasLoad * load = &memory->atlas_load;
+    for(unsigned int i = 0 ; i < SPRITE_SHEET_SOURCE_COUNT ; i++){
+        load->requests[i] = platform_request_image(sprite_sheet_sources[i].filepath);
+    }
+    load->pixels = nullptr;
+    load->next_row = 0;
+    load->state = ATLAS_LOAD_DECODING;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, renderer->cbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * renderer->added_colors, (void *) renderer->mem_color_buffer);
+// packs the decoded sheets (nullptr for the ones that failed) and composes
+// the atlas pixels into load->pixels
+int build_texture_atlas(GameMemory * memory, const unsigned char ** images, const unsigned int * widths, const unsigned int * heights){
+    MEMORY_TAG_SCOPE(MEMORY_TAG_ASSETS);
+    TextureAtlas * atlas = &memory->atlas;
+    *atlas = {};
+
+    unsigned char white[4 * 4 * 4];
+    memset(white, 0xff, sizeof(white));
+    int white_sheet = atlas_add_sheet(atlas, white, 4, 4, 1, 1);
+
+    memory->sprite_sheet_count = 0;
+
+    // regions of every metadata sheet, only needed until the atlas is packed
+    STACK_SCOPE(&memory->temporary);
+    AtlasRegion * regions = PUSH_IN_STACK(&memory->temporary, AtlasRegion, ATLAS_MAX_CELLS);
+    unsigned int region_count = 0;
+    for(unsigned int i = 0 ; i < SPRITE_SHEET_SOURCE_COUNT ; i++){
+        const SpriteSheetSource * source = sprite_sheet_sources + i;
+
+        // a missing sheet still reserves its cells so the tile ids of the 
+        // sheets after it do not move, it just shows up white
+        unsigned int width = images[i] ? widths[i] : 4;
+        unsigned int height = images[i] ? heights[i] : 4;
+        if (images[i] == nullptr) printf("failed to load texture %s\n", source->filepath);
+        const unsigned char * pixels = images[i] ? images[i] : white;
+
+        int sheet = -1;
+        if (images[i] && source->metadata && regions){
+            int count = atlas_load_kenney_xml(source->metadata, regions + region_count, ATLAS_MAX_CELLS - region_count);
+            if (count > 0){
+                sheet = atlas_add_sheet_regions(atlas, pixels, width, height, regions + region_count, count);
+                region_count += count;
+            } else {
+                printf("failed to read sprite metadata %s, using the %ux%u grid\n", source->metadata, source->x_max, source->y_max);
+            }
+        }
+        if (sheet == -1) sheet = atlas_add_sheet(atlas, pixels, width, height, source->x_max, source->y_max);
+        if (sheet == -1) continue;
+
+        SpriteSheet * sprite = memory->sprite_sheets + memory->sprite_sheet_count;
+        sprite->texture = &memory->atlas_texture;
+        sprite->x_max = atlas->sheets[sheet].x_max;
+        sprite->y_max = atlas->sheets[sheet].y_max;
+        sprite->atlas_sheet = sheet;
+        sprite->first_cell = atlas->sheets[sheet].first_cell;
+        sprite->cells = atlas->cells + sprite->first_cell;
+        memory->sprite_sheet_count += 1;
+    }
 
-    glBindBuffer(GL_ARRAY_BUFFER, renderer->uvo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * renderer->added_uv_coords, (void *) renderer->mem_uv_coord_buffer);
+    int result = atlas_pack(atlas, memory->max_texture_size);
+    if (result == 0){
+        memory->atlas_load.pixels = (unsigned char *) malloc((size_t) atlas->width * atlas->height * 4);
+        atlas_write_pixels(atlas, memory->atlas_load.pixels);
+        printf("texture atlas : %u sheets packed in %ux%u\n", atlas->sheet_count, atlas->width, atlas->height);
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->ibo);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(unsigned int) * renderer->added_indices, (void *) renderer->mem_index_buffer);
+    // zero sized rect in the middle of the white sheet, every corner of a 
+    // flat colored quad samples the same texel
+    const AtlasSheet * sheet = atlas->sheets + white_sheet;
+    memory->white_rect.uv_pos = sheet->rect.uv_pos + sheet->rect.uv_dim * 0.5f;
+    memory->white_rect.uv_dim = glm::vec2(0.0f);
+    return result;
 }
 
+// @note: called at the start of every update. once every sheet is decoded
+//        the atlas is packed and its rows go out as texture upload commands,
+//        TEXTURE_UPLOAD_BYTES_PER_FRAME worth per frame. draws keep using 
+//        the plain texture until the render thread has the last rows
+void update_texture_atlas_load(GameMemory * memory){
+    PROFILE_FUNCTION();
+    TextureAtlasLoad * load = &memory->atlas_load;
+
+    if (load->state == ATLAS_LOAD_DECODING){
+        const unsigned char * images[SPRITE_SHEET_SOURCE_COUNT] = {};
+        unsigned int widths[SPRITE_SHEET_SOURCE_COUNT] = {};
+        unsigned int heights[SPRITE_SHEET_SOURCE_COUNT] = {};
+        for(unsigned int i = 0 ; i < SPRITE_SHEET_SOURCE_COUNT ; i++){
+            int state = platform_poll_image(load->requests[i], images + i, widths + i, heights + i);
+            if (state == IMAGE_REQUEST_PENDING || state == IMAGE_REQUEST_DECODING) return;
+            if (state != IMAGE_REQUEST_DECODED) images[i] = nullptr;
+        }
 
-void draw(Renderer2D * renderer, GLint program, const glm::mat4 & matrix, const Texture2D & texture){
-    glUseProgram(program);
-    GLint projectionLocation = glGetUniformLocation(program, "projection");
-    glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, glm::value_ptr(matrix));
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
-    glUniform1i(glGetUniformLocation(program, "spriteTexture"), 0);
-    glBindVertexArray(renderer->vao);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->ibo);
-    glDrawElements(GL_TRIANGLES, renderer->added_indices, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+        int result = build_texture_atlas(memory, images, widths, heights);
+        for(unsigned int i = 0 ; i < SPRITE_SHEET_SOURCE_COUNT ; i++){
+            platform_release_image(load->requests[i]);
+        }
+        if (result){
+            printf("failed to build texture atlas\n");
+            load->state = ATLAS_LOAD_IDLE;
+            return;
+        }
+        load->next_row = 0;
+        load->state = ATLAS_LOAD_UPLOADING;
+    }
+
+    if (load->state == ATLAS_LOAD_UPLOADING){
+        TextureAtlas * atlas = &memory->atlas;
+        size_t row_size = (size_t) atlas->width * 4;
+        unsigned int row_count = TEXTURE_UPLOAD_BYTES_PER_FRAME / row_size;
+        if (row_count == 0) row_count = 1;
+        if (row_count > atlas->height - load->next_row) row_count = atlas->height - load->next_row;
+
+        RenderCommandTextureUpload * upload = (RenderCommandTextureUpload *) push_render_command(
+                g_render_commands, RENDER_COMMAND_TEXTURE_UPLOAD, sizeof(RenderCommandTextureUpload), alignof(RenderCommandTextureUpload));
+        if (upload == nullptr) return;
+
+        upload->texture = &memory->atlas_texture;
+        upload->width = atlas->width;
+        upload->height = atlas->height;
+        upload->first_row = load->next_row;
+        upload->pixels = copy_to_render_commands(load->pixels + load->next_row * row_size, row_count * row_size);
+        // the rows are sent again next frame when the arena is out of space
+        upload->row_count = upload->pixels ? row_count : 0;
+
+        load->next_row += upload->row_count;
+        if (load->next_row == atlas->height){
+            free(load->pixels);
+            load->pixels = nullptr;
+            load->state = ATLAS_LOAD_IDLE;
+        }
+    }
 }
 
 
@@ -552,75 +858,82 @@ void gamespace_init_function(MemoryBlock * gspace_mem){
             (size_t) gspace_mem->ptr % alignof(GameMemory));
     GameMemory * game_mem = GET_ALIGNMENT_POINTER(gspace_mem->ptr, GameMemory);
 
+    // @note: with a reserved block only GameMemory is committed here, the 
+    //        arenas commit their pages as they grow. the split is then only
+    //        one of address space so the temporary stack gets a quarter
     size_t remaining_size = gspace_mem->size - game_memory_offset - sizeof(GameMemory);
 
-    game_mem->permanent.ptr =  (char *) game_mem + sizeof(GameMemory);
-    game_mem->permanent.size =  remaining_size - remaining_size / 2;
-    game_mem->permanent.cur = 0;
+    // the per thread scratch stacks are at the end
+    size_t frame_memory_size = SCRATCH_ARENA_COUNT * SCRATCH_ARENA_SIZE;
+    if (gspace_mem->size < game_memory_offset + sizeof(GameMemory) + 2 * frame_memory_size){
+        printf("game memory block too small\n");
+        return;
+    }
+    remaining_size -= frame_memory_size;
+    size_t temporary_size = remaining_size / 4;
+    if ((gspace_mem->flags & MEMORY_RESERVED) == 0) temporary_size = remaining_size / 2;
+
+    if (gspace_mem->flags & MEMORY_RESERVED){
+        if (commit_memory(gspace_mem->ptr, game_memory_offset + sizeof(GameMemory), gspace_mem->flags)){
+            printf("unable to commit game memory\n");
+            return;
+        }
+    }
+
+    init_arena(
+            &game_mem->permanent,
+            (char *) game_mem + sizeof(GameMemory),
+            remaining_size - temporary_size,
+            gspace_mem->flags
+            );
 
     init_stack_allocator(
             &game_mem->temporary, 
             (char *) game_mem + sizeof(GameMemory) + game_mem->permanent.size,
-            remaining_size / 2
+            temporary_size,
+            gspace_mem->flags
             );
 
-    // Resource loading
-    game_mem->game_renderer = {0};
-    init_renderer(game_mem, &game_mem->game_renderer);
-
-    game_mem->static_ui_renderer = {0};
-    init_renderer(game_mem, &game_mem->static_ui_renderer);
-
-    // Shader compilation
-
-    GLint v1s = compile_shader(game_mem, (char *)v1, GL_VERTEX_SHADER);
-    GLint v2s = compile_shader(game_mem, (char *)v2, GL_VERTEX_SHADER);
-    GLint v3s = compile_shader(game_mem, (char *)v3, GL_VERTEX_SHADER);
-    GLint v4s = compile_shader(game_mem, (char *)v4, GL_VERTEX_SHADER);
+    char * frame_memory = (char *) game_mem + sizeof(GameMemory) + remaining_size;
+    for(unsigned int i = 0 ; i < SCRATCH_ARENA_COUNT ; i++){
+        init_stack_allocator(game_mem->scratch + i, frame_memory + i * SCRATCH_ARENA_SIZE, SCRATCH_ARENA_SIZE, gspace_mem->flags);
+    }
 
-    GLint f1s = compile_shader(game_mem, (char *)f1, GL_FRAGMENT_SHADER);
-    GLint f2s = compile_shader(game_mem, (char *)f2, GL_FRAGMENT_SHADER);
-    GLint f3s = compile_shader(game_mem, (char *)f3, GL_FRAGMENT_SHADER);
-    GLint f4s = compile_shader(game_mem, (char *)f4, GL_FRAGMENT_SHADER);
+    // Resource loading
+    {
+        MEMORY_TAG_SCOPE(MEMORY_TAG_RENDERER);
+        game_mem->game_renderer = {0};
+        init_renderer(game_mem, &game_mem->game_renderer);
 
-    GLint s1[] = {v1s, f1s};
-    GLint s2[] = {v2s, f2s};
-    GLint s3[] = {v3s, f3s};
-    GLint s4[] = {v4s, f4s};
+        game_mem->static_ui_renderer = {0};
+        init_renderer(game_mem, &game_mem->static_ui_renderer);
+    }
 
-    GLint p1 = link_program(game_mem, s1, 2);
-    GLint p2 = link_program(game_mem, s2, 2);
-    GLint p3 = link_program(game_mem, s3, 2);
-    GLint p4 = link_program(game_mem, s4, 2);
+    // Shader loading, the variants are compiled on first use by the render thread
 
-    game_mem->p1 = p1;
-    game_mem->p2 = p2;
-    game_mem->p3 = p3;
-    game_mem->p4 = p4;
+    game_mem->quad_shader = {};
+    game_mem->quad_shader.source = load_shader_source(QUAD_SHADER_FILE);
+    if (game_mem->quad_shader.source == nullptr) printf("failed to load shader %s\n", QUAD_SHADER_FILE);
+    platform_watch_directory(BREAD_SHADER_DIRECTORY);
+    game_mem->render_state = {};
 
     // game specific code
     
     Texture2D plain_texture = {};
-    if(load_plain_texture(&plain_texture)){
+    if(platform_is_headless() == false && load_plain_texture(&plain_texture)){
         printf("failed to load plain texture\n");
     }
-    const char * texture_path = "/home/nitesh/work/projects/active/beta-one/data/kenney_scribble-platformer/Spritesheet/spritesheet_retina.png";
-    Texture2D sprite_sheet_texture = {};
-    if(load_texture_memory( &sprite_sheet_texture, texture_path)) {
-        printf("failed to load texture %s\n", texture_path);
-    }
-
-    printf("texture loaded: width = %u, height %u\n", sprite_sheet_texture.width, sprite_sheet_texture.height);
-
-
-    
-    game_mem->tile_texture  = sprite_sheet_texture;
     game_mem->plain_texture = plain_texture;
 
-    game_mem->sprite_sheet = {0};
-    game_mem->sprite_sheet.texture = &game_mem->tile_texture;
-    game_mem->sprite_sheet.x_max = 11;
-    game_mem->sprite_sheet.y_max = 11;
+    // the atlas streams in over the first frames, see update_texture_atlas_load
+    GLint max_texture_size = HEADLESS_MAX_TEXTURE_SIZE;
+    if (platform_is_headless() == false) glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    game_mem->max_texture_size = max_texture_size;
+    game_mem->atlas_texture = {};
+    game_mem->upload_pbo = 0;
+    game_mem->sprite_sheet_count = 0;
+    game_mem->white_rect = {};
+    begin_texture_atlas_load(game_mem);
 
     const float xresolution = 800;
     const float yresolution = 600;
@@ -637,13 +950,18 @@ void gamespace_init_function(MemoryBlock * gspace_mem){
 
     game_mem->static_ortho_projection =  glm::ortho(0.0f, xresolution, 0.0f, yresolution, 0.0f, 1000.0f);
 
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClearDepth(1.0f);
+    if (platform_is_headless() == false){
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClearDepth(1.0f);
+    }
 
     StaticWorldInformation * world = &game_mem->level_editor.world_info;
     world->space_width = 120;
     world->space_height= 80;
-    world->static_indices = ALLOCATE_ARRAY(&game_mem->permanent, int, world->space_width * world->space_height);
+    {
+        MEMORY_TAG_SCOPE(MEMORY_TAG_WORLD);
+        world->static_indices = ALLOCATE_ARRAY(&game_mem->permanent, int, world->space_width * world->space_height);
+    }
 
     // FIXME : this does not feel right but this can be done
     for(unsigned int i = 0 ; i < world->space_width * world->space_height ; i++){
@@ -655,7 +973,8 @@ void gamespace_init_function(MemoryBlock * gspace_mem){
     editor->selected_sprite_y = 0;
     editor->per_sprite_width = 50;
     editor->per_sprite_height= 50;
-    editor->sprite = &game_mem->sprite_sheet;
+    editor->selected_sheet = 0;
+    editor->sprite = game_mem->sprite_sheets;
     
 
     // initailize currnet game state
@@ -681,11 +1000,24 @@ void gamespace_init_function(MemoryBlock * gspace_mem){
     // we want to add 2 blocks which are 100 unit away 
     // and a player box which is 150 in size
 
+    {
+        MEMORY_TAG_SCOPE(MEMORY_TAG_PHYSICS);
+        if (init_pool(&game_mem->colliders, &game_mem->permanent, MAX_COLLIDER_COUNT)){
+            printf("failed to allocate the collider pool\n");
+        }
+    }
     reset_game_entities(game_mem);
 }
 
+// @note: the pool is cleared first so handles held from before the reset
+//        stop resolving, the new colliders are packed from the start again
 void reset_game_entities(GameMemory * game_mem){
-    BoxCollider * colliders = game_mem->colliders;
+    Pool<BoxCollider> * pool = &game_mem->colliders;
+    pool_clear(pool);
+    for(unsigned int i = 0 ; i < 5 ; i++){
+        if (pool_alloc(pool) == POOL_NULL_HANDLE) return;
+    }
+    BoxCollider * colliders = pool->items;
 
     glm::vec2 delta = glm::vec2(game_mem->xresolution * 0.5 - 70, game_mem->yresolution * 0.5 - 70);
 
@@ -719,9 +1051,7 @@ void reset_game_entities(GameMemory * game_mem){
     colliders[4].velocity = glm::vec2(0.0, 0.0);
     colliders[4].properties = STATIC;
 
-    game_mem->collider_count = 5;
-    
-    game_mem->player.box_collider_idx = 2;
+    game_mem->player.box_collider = pool_handle(pool, 2);
 
     reset_stack_allocator(&game_mem->temporary);
 }
@@ -738,13 +1068,204 @@ void render_static_world(GameMemory * pointer){
     printf("render_static_world :: functionality not immplemented\n");
 }
 
-void render_world(GameMemory * pointer){
-    StaticWorldInformation * world =  &pointer->level_editor.world_info;
+// scratch stack of the calling thread, only valid on the main thread and on
+// the workers of platform_run_parallel
+MemoryStackAllocator * scratch_stack(GameMemory * memory){
+    return memory->scratch + platform_thread_index();
+}
+
+// @note: called once at the end of every update, nothing pushed during the
+//        frame to the temporary stack or the scratch stacks survives it.
+//        guard bands of the stacks are checked as they are released, the
+//        permanent arena is walked here
+void end_frame_memory(GameMemory * memory){
+#ifdef BREAD_MEMORY_GUARDS
+    check_arena_guards(&memory->permanent);
+#endif
+    memory_stats_end_frame();
+    begin_stack_frame(&memory->temporary);
+    for(unsigned int i = 0 ; i < SCRATCH_ARENA_COUNT ; i++){
+        begin_stack_frame(memory->scratch + i);
+    }
+}
+
+// used and committed bytes of every allocator and the bytes pushed per tag,
+// padding is what alignment and guard bands cost the permanent arena
+void draw_memory_dashboard(GameMemory * memory){
+    const MemoryStats * stats = memory_stats();
+
+    ImGui::Begin("Memory");
+    const MemoryArena * permanent = &memory->permanent;
+    ImGui::Text("permanent    : %lu KB used, %lu KB committed of %lu MB", 
+            permanent->cur / 1024, permanent->committed / 1024, permanent->size / MB(1));
+    ImGui::Text("               %lu KB padding (%.1f%%)", 
+            permanent->padding / 1024, permanent->cur ? 100.0 * permanent->padding / permanent->cur : 0.0);
+
+    const MemoryStackAllocator * temporary = &memory->temporary;
+    ImGui::Text("temporary    : %lu KB last frame, %lu KB peak, %lu KB committed", 
+            temporary->frame_high_water / 1024, temporary->peak / 1024, temporary->committed / 1024);
+
+    size_t scratch_frame = 0, scratch_peak = 0, scratch_committed = 0;
+    for(unsigned int i = 0 ; i < SCRATCH_ARENA_COUNT ; i++){
+        scratch_frame += memory->scratch[i].frame_high_water;
+        scratch_peak = std::max(scratch_peak, memory->scratch[i].peak);
+        scratch_committed += memory->scratch[i].committed;
+    }
+    ImGui::Text("scratch      : %lu KB last frame, %lu KB peak, %lu KB committed", 
+            scratch_frame / 1024, scratch_peak / 1024, scratch_committed / 1024);
+
+    if (stats->damaged_guards){
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "guard bands overwritten : %lu", stats->damaged_guards);
+    }
+
+    if (ImGui::BeginTable("memory tags", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)){
+        ImGui::TableSetupColumn("tag");
+        ImGui::TableSetupColumn("permanent KB");
+        ImGui::TableSetupColumn("allocations");
+        ImGui::TableSetupColumn("last frame KB");
+        ImGui::TableSetupColumn("frame peak KB");
+        ImGui::TableHeadersRow();
+        for(unsigned int i = 0 ; i < MEMORY_TAG_COUNT ; i++){
+            const MemoryTagStats * tag = stats->tags + i;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%s", memory_tag_name(i));
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", tag->arena_bytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%lu", tag->arena_count);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", tag->last_frame_bytes / 1024.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.1f", tag->frame_peak / 1024.0);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+// tile vertices are built in parallel, the grid is split into bands of rows
+// and every band first collects its tiles so that the quad slots of each band
+// are known before any of them is written
+#define TILE_ROWS_PER_JOB   8
+
+// tile collected by count_tiles_job, with its grid position and sprite so
+// that write_tiles_job does not have to go back to the grid
+struct TileRef {
+    unsigned int x;
+    unsigned int y;
+    int value;
+};
+
+struct TileVertexJobs {
+    GameMemory * memory;
+    Renderer2D * renderer;
+    LevelEditor * editor;
+    const TextureAtlas * atlas;
+
+    // first quad slot of every job, job_count + 1 entries
+    size_t * job_quad_offsets;
+    size_t   max_quads;
+
+    // every tile a job draws, pushed by the counting job to the scratch 
+    // stack of its thread and left there until the end of the frame, so 
+    // the writing job can read it from whichever thread runs it
+    TileRef ** job_tiles;
+
+    // filled tiles are drawn with their sprite, empty ones with a flat color
+    bool      filled;
+    glm::vec4 color;
+    AtlasRect white;
+};
+
+void count_tiles_job(void * data, unsigned int job_index){
+    TileVertexJobs * jobs = (TileVertexJobs *) data;
+    StaticWorldInformation * world = &jobs->editor->world_info;
+
+    unsigned int first_row = job_index * TILE_ROWS_PER_JOB;
+    unsigned int last_row  = std::min(first_row + TILE_ROWS_PER_JOB, world->space_height);
+
+    TileRef * tiles = PUSH_IN_STACK(scratch_stack(jobs->memory), TileRef, (last_row - first_row) * world->space_width);
+    jobs->job_tiles[job_index] = tiles;
+    if (tiles == nullptr){
+        printf("renderer :: scratch stack full, dropping rows %u to %u\n", first_row, last_row);
+        jobs->job_quad_offsets[job_index + 1] = 0;
+        return;
+    }
+
+    size_t count = 0;
+    for(unsigned int y = first_row ; y < last_row ; y++){
+        const int * row = world->static_indices + y * world->space_width;
+        for(unsigned int x = 0 ; x < world->space_width ; x++){
+            tiles[count] = { x, y, row[x] };
+            count += (row[x] != -1) == jobs->filled;
+        }
+    }
+    jobs->job_quad_offsets[job_index + 1] = count;
+}
+
+void write_tiles_job(void * data, unsigned int job_index){
+    TileVertexJobs * jobs = (TileVertexJobs *) data;
+    LevelEditor * editor = jobs->editor;
+
+    glm::vec2 target_size = glm::vec2(editor->per_sprite_width, editor->per_sprite_height);
+    const AtlasRect * cells = jobs->atlas->cells;
+
+    const TileRef * tiles = jobs->job_tiles[job_index];
+    size_t quad  = jobs->job_quad_offsets[job_index];
+    size_t count = jobs->job_quad_offsets[job_index + 1] - quad;
+    for(size_t i = 0 ; i < count && quad < jobs->max_quads ; i++){
+        const TileRef & tile = tiles[i];
+        glm::vec2 target_pos = glm::vec2(tile.x * editor->per_sprite_width, tile.y * editor->per_sprite_height);
+        if (jobs->filled){
+            const AtlasRect & cell = cells[tile.value];
+            write_quad<QUAD_TEXTURED>(jobs->renderer, quad, target_pos, target_size, glm::vec4(1.0), cell.uv_pos, cell.uv_dim);
+        } else {
+            write_quad<QUAD_COLORED | QUAD_TEXTURED>(jobs->renderer, quad, target_pos, target_size, jobs->color, jobs->white.uv_pos, jobs->white.uv_dim);
+        }
+        quad += 1;
+    }
+}
+
+void render_tiles(GameMemory * pointer, Renderer2D * renderer, bool filled, glm::vec4 color){
+    PROFILE_FUNCTION();
     LevelEditor * editor = &pointer->level_editor;
+    StaticWorldInformation * world = &editor->world_info;
+
+    unsigned int job_count = (world->space_height + TILE_ROWS_PER_JOB - 1) / TILE_ROWS_PER_JOB;
+    // both arrays are pushed here on the main thread before any job runs,
+    // every job only writes its own entries
+    STACK_SCOPE(&pointer->temporary);
+    size_t * offsets = PUSH_IN_STACK(&pointer->temporary, size_t, job_count + 1);
+    TileRef ** tiles = PUSH_IN_STACK(&pointer->temporary, TileRef *, job_count);
+    if (offsets == nullptr || tiles == nullptr) return;
+
+    TileVertexJobs jobs = {};
+    jobs.memory = pointer;
+    jobs.renderer = renderer;
+    jobs.editor = editor;
+    jobs.atlas = &pointer->atlas;
+    jobs.job_quad_offsets = offsets;
+    jobs.job_tiles = tiles;
+    jobs.max_quads = renderer->total_indices / 6;
+    jobs.filled = filled;
+    jobs.color = color;
+    jobs.white = pointer->white_rect;
+
+    offsets[0] = renderer->added_indices / 6;
+    platform_run_parallel(count_tiles_job, &jobs, job_count);
+    for(unsigned int i = 0 ; i < job_count ; i++){
+        offsets[i + 1] += offsets[i];
+    }
 
-    unsigned int sprite_x_max = editor->sprite->x_max;
-    unsigned int sprite_y_max = editor->sprite->y_max;
+    size_t end_quad = offsets[job_count];
+    if (end_quad > jobs.max_quads){
+        printf("renderer :: buffer entirly full, dropping %lu tiles\n", end_quad - jobs.max_quads);
+        end_quad = jobs.max_quads;
+    }
 
+    platform_run_parallel(write_tiles_job, &jobs, job_count);
+    reserve_quads(renderer, end_quad - renderer->added_indices / 6);
+}
+
+void render_world(GameMemory * pointer){
+    PROFILE_FUNCTION();
+    MEMORY_TAG_SCOPE(MEMORY_TAG_RENDERER);
     // GLint projectionLoadtion = glGetUniformLocation(pointer->p4,  "projection");
     // glUseProgram(pointer->p4);
     // glUniformMatrix4fv(projectionLoadtion, 1, GL_FALSE, glm::value_ptr(pointer->camera.projection));
@@ -753,31 +1274,9 @@ void render_world(GameMemory * pointer){
     // glBindTexture(GL_TEXTURE_2D, pointer->tile_texture.id);
     // glUniform1i(glGetUniformLocation(pointer->p4, "spriteTexture"), 0);
     start_rendering(&pointer->game_renderer);
-    for(unsigned int i = 0 ; i < world->space_width * world->space_height ; i++){
-        if (world->static_indices[i] == -1) continue;
-
-        int pos_x_offset = i % world->space_width;
-        int pos_y_offset = i / world->space_width;
-
-        glm::vec2 target_pos = glm::vec2(pos_x_offset * editor->per_sprite_width, pos_y_offset * editor->per_sprite_height);
-        glm::vec2 target_size= glm::vec2(editor->per_sprite_width, editor->per_sprite_height);
-
-
-        int value = world->static_indices[i];
-        unsigned int tex_x_offset = value % sprite_x_max;
-        unsigned int tex_y_offset = value / sprite_x_max;
-        glm::vec2 target_uv_pos = glm::vec2( ((float) tex_x_offset) / sprite_x_max, ((float) tex_y_offset) / sprite_y_max);
-        glm::vec2 target_uv_size = glm::vec2( 1.0f / sprite_x_max , 1.0f/ sprite_y_max);
-
-        render_quad_rect_tex(&pointer->game_renderer,
-                target_pos,
-                target_size,
-                glm::vec4(1.0),
-                target_uv_pos,
-                target_uv_size);
-    }
+    render_tiles(pointer, &pointer->game_renderer, true, glm::vec4(1.0));
     end_rendering(&pointer->game_renderer);
-    draw(&pointer->game_renderer, pointer->p4, pointer->camera.projection, pointer->tile_texture);
+    draw(&pointer->game_renderer, SHADER_FEATURE_TEXTURED | SHADER_FEATURE_PROJECTION, pointer->camera.projection, &pointer->atlas_texture);
 }
 
 
@@ -785,12 +1284,15 @@ void render_world(GameMemory * pointer){
 #define FLOAT_NEG_INFINITY         -10e30
 
 void update_physics(GameMemory * pointer, float delta_time){
+    PROFILE_FUNCTION();
+    MEMORY_TAG_SCOPE(MEMORY_TAG_PHYSICS);
 
 
     // checking and updating collision logic
 
-    for(unsigned int i = 0 ; i < pointer->collider_count ; i++){
-        BoxCollider * current = pointer->colliders + i;
+    Pool<BoxCollider> * colliders = &pointer->colliders;
+    for(unsigned int i = 0 ; i < colliders->count ; i++){
+        BoxCollider * current = colliders->items + i;
 
 
         struct collision_idx_info{
@@ -801,9 +1303,6 @@ void update_physics(GameMemory * pointer, float delta_time){
 
         glm::vec2 movement = delta_time * current->velocity;
 
-        // @note: there seems to be a bug in the STACK based allocator
-        // resulting in a program crashing memory leak 
-
         if (current->properties != GRAVITY) continue;
 
         // @note: for now we are only using this array for collision resolution
@@ -811,25 +1310,26 @@ void update_physics(GameMemory * pointer, float delta_time){
         //        I would leave in temp mem array  (collision_list) and later we 
         //        can abstract it out
 
+        STACK_SCOPE(&pointer->temporary);
         collision_idx_info * collision_list
             = PUSH_IN_STACK(
                     &pointer->temporary, 
                     collision_idx_info, 
-                    pointer->collider_count - 1
+                    colliders->count - 1
                     );
         unsigned int collision_count = 0;
 
-        for(unsigned int j = 0  ; j < pointer->collider_count ; j++){
+        for(unsigned int j = 0  ; j < colliders->count ; j++){
 
             // @note: BIG ASSUMPTION, WE ARE NOT INSIDE THE OBJECT WE ARE COLLIDING WITH
             //        ELSE THIS ENTIRE SIMULATION WILL BREAK DOWN
 
-            if (j == i || pointer->colliders[j].properties == NONE) continue;
+            if (j == i || colliders->items[j].properties == NONE) continue;
 
             ImGui::Begin("Collision detection debug");
 
             ImGui::Text("For target index %u", j);
-            BoxCollider target = pointer->colliders[j];
+            BoxCollider target = colliders->items[j];
             target.dim = target.dim +  current->dim;
 
             glm::vec2 t_near, t_far;
@@ -950,8 +1450,6 @@ void update_physics(GameMemory * pointer, float delta_time){
 
         }
         ImGui::End();
-
-        POP_FROM_STACK(&pointer->temporary);
     }
 }
 
@@ -972,7 +1470,7 @@ void render_collision_test(GameMemory * pointer){
     
     // b2->rot = 0.0f;
 
-    bool collided = check_collision_via_sat(b1, b2);
+    bool collided = check_collision_via_sat(b1, b2, scratch_stack(pointer));
 
     // render the positions
 
@@ -990,7 +1488,7 @@ void render_collision_test(GameMemory * pointer){
     start_rendering(&pointer->game_renderer);
 
     {
-        render_quad_rect_tex_rot(
+        render_quad<QUAD_COLORED | QUAD_ROTATED>(
                 &pointer->game_renderer,
                 b1->pos - 0.5f * b1->dim,
                 b1->dim,
@@ -1007,7 +1505,7 @@ void render_collision_test(GameMemory * pointer){
         if (collided){
             color = glm::vec4(1.0, 0.5, 1.0, 1.0);
         }
-        render_quad_rect_tex_rot(
+        render_quad<QUAD_COLORED | QUAD_ROTATED>(
                 &pointer->game_renderer,
                 b2->pos - 0.5f * b2->dim,
                 b2->dim,
@@ -1020,46 +1518,89 @@ void render_collision_test(GameMemory * pointer){
     }
     
     end_rendering(&pointer->game_renderer);
-    draw(&pointer->game_renderer, pointer->p4, pointer->camera.projection, pointer->plain_texture);
+    draw(&pointer->game_renderer, SHADER_FEATURE_VERTEX_COLOR | SHADER_FEATURE_PROJECTION, pointer->camera.projection, nullptr);
 }
 
 
 
 
 void render_game_elements(GameMemory * pointer) {
+    PROFILE_FUNCTION();
+    MEMORY_TAG_SCOPE(MEMORY_TAG_RENDERER);
 
     // rendering code :: this needs improvement 
 
-    start_rendering(&pointer->game_renderer);
-
-    for(unsigned int i = 0 ; i < pointer->collider_count; i++){
-
-
-        BoxCollider * box = pointer->colliders + i;
+    // sprite attributes are gathered into one temporary block as structure 
+    // of arrays so that they can be submitted as a single batch
+    unsigned int capacity = pointer->colliders.count;
+    STACK_SCOPE(&pointer->temporary);
+    float * attributes = PUSH_IN_STACK(&pointer->temporary, float, capacity * 13);
+    if (attributes == nullptr) return;
+
+    float * pos_x   = attributes + capacity * 0;
+    float * pos_y   = attributes + capacity * 1;
+    float * dim_x   = attributes + capacity * 2;
+    float * dim_y   = attributes + capacity * 3;
+    float * rot     = attributes + capacity * 4;
+    float * uv_pos  = attributes + capacity * 5;
+    float * uv_dim  = attributes + capacity * 6;
+    float * pivot_x = attributes + capacity * 7;
+    float * pivot_y = attributes + capacity * 8;
+    float * color   = attributes + capacity * 9;
+
+    unsigned int count = 0;
+    const BoxCollider * player = pool_get(&pointer->colliders, pointer->player.box_collider);
+    for(unsigned int i = 0 ; i < pointer->colliders.count; i++){
+        BoxCollider * box = pointer->colliders.items + i;
         if (box->properties == NONE) continue;
 
-        glm::vec4 color = glm::vec4(1.0, 1.0, 1.0, 1.0);
-        if (i == pointer->player.box_collider_idx) {
-            color = glm::vec4(0.0, 1.0, 0.0, 1.0);
+        glm::vec4 box_color = glm::vec4(1.0, 1.0, 1.0, 1.0);
+        if (box == player) {
+            box_color = glm::vec4(0.0, 1.0, 0.0, 1.0);
         }
-        render_quad_rect_tex_rot(
-                &pointer->game_renderer,
-                box->pos - 0.5f * box->dim,
-                box->dim,
-                color,
-                glm::vec2(0),
-                glm::vec2(1),
-                box->center,
-                box->rot);
+
+        pos_x[count]   = box->pos.x;
+        pos_y[count]   = box->pos.y;
+        dim_x[count]   = box->dim.x;
+        dim_y[count]   = box->dim.y;
+        rot[count]     = box->rot;
+        uv_pos[count]  = 0.0f;
+        uv_dim[count]  = 0.0f;
+        pivot_x[count] = box->center.x;
+        pivot_y[count] = box->center.y;
+        color[count * 4 + 0] = box_color.x;
+        color[count * 4 + 1] = box_color.y;
+        color[count * 4 + 2] = box_color.z;
+        color[count * 4 + 3] = box_color.w;
+        count += 1;
     }
 
-    
+    SpriteBatch batch = {};
+    batch.pos_x   = pos_x;
+    batch.pos_y   = pos_y;
+    batch.dim_x   = dim_x;
+    batch.dim_y   = dim_y;
+    batch.rot     = rot;
+    batch.uv_x    = uv_pos;
+    batch.uv_y    = uv_pos;
+    batch.uv_w    = uv_dim;
+    batch.uv_h    = uv_dim;
+    batch.pivot_x = pivot_x;
+    batch.pivot_y = pivot_y;
+    batch.color   = color;
+    batch.count   = count;
+
+    start_rendering(&pointer->game_renderer);
+    render_sprites(&pointer->game_renderer, &batch);
     end_rendering(&pointer->game_renderer);
-    draw(&pointer->game_renderer, pointer->p4, pointer->camera.projection, pointer->plain_texture);
+    // flat colored boxes, the variant does not sample a texture at all
+    draw(&pointer->game_renderer, SHADER_FEATURE_VERTEX_COLOR | SHADER_FEATURE_PROJECTION, pointer->camera.projection, nullptr);
 }
 
 
 void render_tile_placement_gui(GameMemory * pointer){
+    PROFILE_FUNCTION();
+    MEMORY_TAG_SCOPE(MEMORY_TAG_EDITOR);
 
     // processing 
 
@@ -1073,13 +1614,10 @@ void render_tile_placement_gui(GameMemory * pointer){
         unsigned int x_idx = pointer->level_editor.selected_sprite_x;
         unsigned int y_idx = pointer->level_editor.selected_sprite_y;
         unsigned int x_max = pointer->level_editor.sprite->x_max;
-        unsigned int y_max = pointer->level_editor.sprite->y_max;
 
-        target_uv_pos = glm::vec2(
-                1.0f / x_max * (x_idx % x_max),
-                1.0f / y_max * (y_idx % y_max)
-                );
-        target_uv_dim = glm::vec2(1.0/ x_max, 1.0 / y_max);
+        const AtlasRect & cell = editor->sprite->cells[x_idx + y_idx * x_max];
+        target_uv_pos = cell.uv_pos;
+        target_uv_dim = cell.uv_dim;
         tile_indices = glm::ivec2(x_idx, y_idx);
     }
 
@@ -1101,7 +1639,7 @@ void render_tile_placement_gui(GameMemory * pointer){
     ImGui::Text("tile indices :: %d, %d", tile_indices.x, tile_indices.y);
     if (is_button_down(SDL_BUTTON_LEFT)){
         int world_offset = world_indices.x + world_indices.y * world->space_width;
-        int tile_offset = tile_indices.x  + tile_indices.y * editor->sprite->x_max;
+        int tile_offset = editor->sprite->first_cell + tile_indices.x  + tile_indices.y * editor->sprite->x_max;
         if(
                 world_indices.x >= world->space_width || world_indices.x < 0 || 
                 world_indices.y >= world->space_height || world_indices.y < 0
@@ -1129,67 +1667,29 @@ void render_tile_placement_gui(GameMemory * pointer){
     }
     ImGui::End();
 
-    // rendering
+    // rendering, empty and filled tiles all come from the atlas so they go
+    // out as a single draw
     start_rendering(&pointer->game_renderer);
-    
-    for(unsigned int i = 0 ; i < world->space_width * world->space_height ; i++){
-        if(world->static_indices[i] != -1) continue;
-
-        int x_offset = i % world->space_width;
-        int y_offset = i / world->space_width;
-
-        glm::vec2 target_pos = glm::vec2(x_offset * editor->per_sprite_width, y_offset * editor->per_sprite_height);
-        glm::vec2 target_size= glm::vec2(editor->per_sprite_width, editor->per_sprite_height);
-
-        render_quad_rect_tex(&pointer->game_renderer,
-                target_pos,
-                target_size,
-                glm::vec4(0.396, 0.408, 0.62, 0.4),
-                glm::vec2(0.0), glm::vec2(1.0));
-    }
-    end_rendering(&pointer->game_renderer);
-    draw(&pointer->game_renderer, pointer->p4, pointer->camera.projection, pointer->plain_texture);
-
-
-    // glActiveTexture(GL_TEXTURE0);
-    // glBindTexture(GL_TEXTURE_2D, editor->sprite->texture->id);
-    // glUniform1i(glGetUniformLocation(pointer->p4, "spriteTexture"), 0);
-
-    start_rendering(&pointer->game_renderer);
-
-    unsigned int sprite_x_max = editor->sprite->x_max;
-    unsigned int sprite_y_max = editor->sprite->y_max;
+    render_tiles(pointer, &pointer->game_renderer, false, glm::vec4(0.396, 0.408, 0.62, 0.4));
 
+    // @note: ImGui is not thread safe, the debug listing stays on this thread
     ImGui::Begin("Level Render debug");
 
-    for(unsigned int i = 0 ; i < world->space_width * world->space_height ; i++){
-        if (world->static_indices[i] == -1) continue;
-
-        int pos_x_offset = i % world->space_width;
-        int pos_y_offset = i / world->space_width;
+    for(unsigned int y = 0, i = 0 ; y < world->space_height ; y++){
+        for(unsigned int x = 0 ; x < world->space_width ; x++, i++){
+            if (world->static_indices[i] == -1) continue;
 
-        glm::vec2 target_pos = glm::vec2(pos_x_offset * editor->per_sprite_width, pos_y_offset * editor->per_sprite_height);
-        glm::vec2 target_size= glm::vec2(editor->per_sprite_width, editor->per_sprite_height);
+            glm::vec2 target_pos = glm::vec2(x * editor->per_sprite_width, y * editor->per_sprite_height);
+            glm::vec2 target_size= glm::vec2(editor->per_sprite_width, editor->per_sprite_height);
 
-
-        int value = world->static_indices[i];
-        unsigned int tex_x_offset = value % sprite_x_max;
-        unsigned int tex_y_offset = value / sprite_x_max;
-        glm::vec2 target_uv_pos = glm::vec2( ((float) tex_x_offset) / sprite_x_max, ((float) tex_y_offset) / sprite_y_max);
-        glm::vec2 target_uv_size = glm::vec2( 1.0f / sprite_x_max , 1.0f/ sprite_y_max);
-
-        ImGui::Text("[%d] target_pos : (%f, %f), target_size: (%f, %f)", i, target_pos.x, target_pos.y, target_size.x, target_size.y);
-
-        render_quad_rect_tex(&pointer->game_renderer,
-                target_pos,
-                target_size,
-                glm::vec4(1.0),
-                target_uv_pos,
-                target_uv_size);
+            ImGui::Text("[%d] target_pos : (%f, %f), target_size: (%f, %f)", i, target_pos.x, target_pos.y, target_size.x, target_size.y);
+        }
     }
     ImGui::End();
 
-    render_quad_rect_tex(&pointer->game_renderer, 
+    render_tiles(pointer, &pointer->game_renderer, true, glm::vec4(1.0));
+
+    render_quad<QUAD_COLORED | QUAD_TEXTURED>(&pointer->game_renderer, 
             mouse_target_pos, 
             mouse_target_size,
             glm::vec4(1.0, 1.0, 0.0, 1.0),
@@ -1197,19 +1697,28 @@ void render_tile_placement_gui(GameMemory * pointer){
             target_uv_dim
             );
     end_rendering(&pointer->game_renderer);
-    draw(&pointer->game_renderer, pointer->p4, pointer->camera.projection, *pointer->level_editor.sprite->texture);
+    draw(&pointer->game_renderer, SHADER_FEATURE_TEXTURED | SHADER_FEATURE_VERTEX_COLOR | SHADER_FEATURE_PROJECTION, pointer->camera.projection, &pointer->atlas_texture);
 }
 
 
 
 
 void render_tile_selection_gui(GameMemory * pointer){
+    PROFILE_FUNCTION();
+    MEMORY_TAG_SCOPE(MEMORY_TAG_EDITOR);
     // setup
     // GLint projectionLoadtion = glGetUniformLocation(pointer->p4,  "projection");
     LevelEditor * editor = &pointer->level_editor;
 
     glm::vec2 tile_render_size = glm::vec2(pointer->yresolution * 0.5);
 
+    if (is_key_pressed(SDLK_TAB) && pointer->sprite_sheet_count > 0){
+        editor->selected_sheet = (editor->selected_sheet + 1) % pointer->sprite_sheet_count;
+        editor->sprite = pointer->sprite_sheets + editor->selected_sheet;
+        editor->selected_sprite_x = 0;
+        editor->selected_sprite_y = 0;
+    }
+
     unsigned int x_idx = pointer->level_editor.selected_sprite_x;
     unsigned int y_idx = pointer->level_editor.selected_sprite_y;
 
@@ -1217,6 +1726,7 @@ void render_tile_selection_gui(GameMemory * pointer){
     unsigned int y_max = pointer->level_editor.sprite->y_max;
 
     ImGui::Begin("Sprite selector");
+    ImGui::Text("sheet            : %u / %u\n", editor->selected_sheet + 1, pointer->sprite_sheet_count);
     ImGui::Text("selected xsplits : %u\n", editor->selected_sprite_x);
     ImGui::Text("selected ysplits : %u\n", editor->selected_sprite_y);
     ImGui::Text("xsplits          : %u\n", x_max);
@@ -1237,12 +1747,11 @@ void render_tile_selection_gui(GameMemory * pointer){
     editor->selected_sprite_x = x_idx;
     editor->selected_sprite_y = y_idx;
 
-    glm::vec2 selected_sheet_offset = glm::vec2(
-            tile_render_size.x / (x_max) * (x_idx % x_max), 
-            tile_render_size.y / (y_max) * (y_idx % y_max)
-        );
-
-    glm::vec2 selected_sheet_size = glm::vec2(tile_render_size.x / x_max, tile_render_size.y / y_max);
+    // the highlight follows the cell rect so it also fits uneven sheets
+    const AtlasRect & sheet_rect = pointer->atlas.sheets[editor->sprite->atlas_sheet].rect;
+    const AtlasRect & selected_cell = editor->sprite->cells[x_idx + y_idx * x_max];
+    glm::vec2 selected_sheet_offset = (selected_cell.uv_pos - sheet_rect.uv_pos) / sheet_rect.uv_dim * tile_render_size;
+    glm::vec2 selected_sheet_size = selected_cell.uv_dim / sheet_rect.uv_dim * tile_render_size;
 
     // render
     // glUseProgram(pointer->p4);
@@ -1253,56 +1762,48 @@ void render_tile_selection_gui(GameMemory * pointer){
     // glBindTexture(GL_TEXTURE_2D, pointer->plain_texture.id);
     // glUniform1i(glGetUniformLocation(pointer->p4, "spriteTexture"), 0);
 
-    // this does not require texture to render stuff
+    // the background and the highlight use the white texel of the atlas so
+    // the whole selector is a single draw
+    const AtlasRect & white = pointer->white_rect;
+
     start_rendering(&pointer->static_ui_renderer);
-    render_quad_rect_tex(
+    render_quad<QUAD_COLORED | QUAD_TEXTURED>(
             &pointer->static_ui_renderer, 
             glm::vec2(0.0, 0.0), 
             glm::vec2(pointer->yresolution * 0.5 + 10), 
             glm::vec4(0.2, 0.4, 0.6, 0.5), 
-            glm::vec2(0.0f), 
-            glm::vec2(1.0f)
-            ); // because teh default uv coordinated are 0 0 
-    end_rendering(&pointer->static_ui_renderer);
-    draw(&pointer->static_ui_renderer, pointer->p4, pointer->static_ortho_projection, pointer->plain_texture);
-
-    // glActiveTexture(GL_TEXTURE0);
-    // glBindTexture(GL_TEXTURE_2D, pointer->tile_texture.id);
-    // glUniform1i(glGetUniformLocation(pointer->p4, "spriteTexture"), 0);
-
-    start_rendering(&pointer->static_ui_renderer);
-    render_quad_rect_tex(
+            white.uv_pos, 
+            white.uv_dim
+            );
+    render_quad<QUAD_TEXTURED>(
             &pointer->static_ui_renderer, 
             glm::vec2(5, 5), 
             glm::vec2(pointer->yresolution * 0.5, pointer->yresolution * 0.5), 
             glm::vec4(1.0), 
-            glm::vec2(0.0), glm::vec2(1.0f)
+            sheet_rect.uv_pos, sheet_rect.uv_dim
             );
-    end_rendering(&pointer->static_ui_renderer);
-    draw(&pointer->static_ui_renderer, pointer->p4, pointer->static_ortho_projection, pointer->tile_texture);
-
-    // glActiveTexture(GL_TEXTURE0);
-    // glBindTexture(GL_TEXTURE_2D, pointer->plain_texture.id);
-    // glUniform1i(glGetUniformLocation(pointer->p4, "spriteTexture"), 0);
-
-    start_rendering(&pointer->static_ui_renderer);
-    
-    render_quad_rect_tex(
+    render_quad<QUAD_COLORED | QUAD_TEXTURED>(
             &pointer->static_ui_renderer,
             glm::vec2(5, 5) + selected_sheet_offset,
             selected_sheet_size,
             glm::vec4(0.8, 0.2, 0.9, 0.5),
-            glm::vec2(0.0), glm::vec2(1.0)
+            white.uv_pos, white.uv_dim
             );
     end_rendering(&pointer->static_ui_renderer);
-    draw(&pointer->static_ui_renderer, pointer->p4, pointer->static_ortho_projection, pointer->plain_texture);
+    draw(&pointer->static_ui_renderer, SHADER_FEATURE_TEXTURED | SHADER_FEATURE_VERTEX_COLOR | SHADER_FEATURE_PROJECTION, pointer->static_ortho_projection, &pointer->atlas_texture);
 }
 
 extern "C"
 void gamespace_update_function(MemoryBlock * gspace_mem){
     
+    PROFILE_FUNCTION();
+    PERF_COUNTER_SCOPE(PERF_SUBSYSTEM_UPDATE);
     GameMemory * pointer = GET_ALIGNMENT_POINTER(gspace_mem->ptr, GameMemory);
 
+    g_render_commands = begin_render_commands();
+    update_texture_atlas_load(pointer);
+    reload_changed_shaders(pointer);
+
     if (is_key_down(SDLK_i)){
         reset_game_entities(pointer);
     }
@@ -1362,33 +1863,173 @@ void gamespace_update_function(MemoryBlock * gspace_mem){
     glm::vec2 worldmousepos = window_to_world_pos(pointer, mouse_window_pos());
     // rendering
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
     // render_collision_test(pointer);
-    render_game_elements(pointer);
+    begin_gpu_pass(GPU_PASS_GAME_ELEMENTS);
+    {
+        PERF_COUNTER_SCOPE(PERF_SUBSYSTEM_GAME_ELEMENTS);
+        render_game_elements(pointer);
+    }
+    end_gpu_pass();
 
 
 
     if (pointer->current_ui == 0){
+        begin_gpu_pass(GPU_PASS_WORLD);
+        PERF_COUNTER_SCOPE(PERF_SUBSYSTEM_WORLD);
         render_world(pointer);
+        end_gpu_pass();
     } 
-    if (pointer->current_ui & TILE_PLACEMENT){
+    // the editor needs the sheet layout, which is known once the atlas is packed
+    if (pointer->current_ui & TILE_PLACEMENT && pointer->sprite_sheet_count){
+        begin_gpu_pass(GPU_PASS_TILE_EDITOR);
+        PERF_COUNTER_SCOPE(PERF_SUBSYSTEM_TILE_EDITOR);
         render_tile_placement_gui(pointer);
+        end_gpu_pass();
     }
-    if (pointer->current_ui & TILE_SELECTION){
+    if (pointer->current_ui & TILE_SELECTION && pointer->sprite_sheet_count){
+        begin_gpu_pass(GPU_PASS_UI);
         render_tile_selection_gui(pointer);
+        end_gpu_pass();
     }
 
+    gpu_profiler_draw_panel();
+    profiler_draw_panel();
+    perf_counters_draw_panel();
+    draw_memory_dashboard(pointer);
+
     ImGui::Begin("player position debug");
-    ImGui::Text("player position : %f %f", pointer->colliders[pointer->player.box_collider_idx].pos.x , pointer->colliders[pointer->player.box_collider_idx].pos.y);
+    const BoxCollider * player = pool_get(&pointer->colliders, pointer->player.box_collider);
+    if (player) ImGui::Text("player position : %f %f", player->pos.x , player->pos.y);
+    else        ImGui::Text("player collider was freed");
     ImGui::End();
 
 
-    update_physics(pointer, delta_time);
-    glDisable(GL_BLEND);
+    {
+        PERF_COUNTER_SCOPE(PERF_SUBSYSTEM_PHYSICS);
+        update_physics(pointer, delta_time);
+    }
 
     // update gamespace ticks
     pointer->previous_ticks = get_ticks_since_start();
+
+    end_frame_memory(pointer);
+}
+
+// @note: runs on the render thread (which owns the GL context) while the
+//        main thread is already simulating the next frame, so only the 
+//        commands are read here and never the live game state
+extern "C"
+void gamespace_render_function(MemoryBlock * gspace_mem, MemoryArena * commands){
+    PROFILE_FUNCTION();
+    if (commands->cur == 0) return;
+    RenderCommandList * list = GET_ALIGNMENT_POINTER(commands->ptr, RenderCommandList);
+
+    GameMemory * pointer = GET_ALIGNMENT_POINTER(gspace_mem->ptr, GameMemory);
+    RenderStateCache * cache = &pointer->render_state;
+    *cache = {};
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    for(RenderCommand * command = list->first ; command ; command = command->next){
+        switch(command->type){
+            case RENDER_COMMAND_UPLOAD:
+                execute_upload_command((RenderCommandUpload *) command->data);
+                break;
+            case RENDER_COMMAND_DRAW:
+                execute_draw_command(pointer, (RenderCommandDraw *) command->data);
+                break;
+            case RENDER_COMMAND_TEXTURE_UPLOAD:
+                execute_texture_upload_command(pointer, (RenderCommandTextureUpload *) command->data);
+                break;
+            case RENDER_COMMAND_RELOAD_SHADER:
+                execute_reload_shader_command(pointer, (RenderCommandReloadShader *) command->data);
+                break;
+            case RENDER_COMMAND_BEGIN_PASS:
+                gpu_profiler_begin_pass(*(unsigned int *) command->data);
+                break;
+            case RENDER_COMMAND_END_PASS:
+                gpu_profiler_end_pass();
+                break;
+            default:
+                printf("renderer :: unknown render command %u\n", command->type);
+                break;
+        }
+    }
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDisable(GL_BLEND);
 }
 
+// game state in the block, GameMemory and everything the permanent arena 
+// handed out (the stacks and the shared arena are empty between frames)
+size_t game_state_size(MemoryBlock * gspace_mem, GameMemory * memory){
+    size_t end = memory->permanent.cur;
+    if (memory->permanent.flags & MEMORY_RESERVED) end = memory->permanent.committed;
+    return (char *) memory->permanent.ptr + end - (char *) gspace_mem->ptr;
+}
+
+void keep_renderer_objects(Renderer2D * restored, const Renderer2D * live){
+    restored->vbo = live->vbo;
+    restored->cbo = live->cbo;
+    restored->uvo = live->uvo;
+    restored->ibo = live->ibo;
+    restored->vao = live->vao;
+}
+
+// @note: a snapshot only carries game state. GL objects, the shader source,
+//        the streamed atlas and the frame allocators belong to the process
+//        that created them (they are made by gamespace_init_function in a
+//        new one), so the live ones are put back over the restored ones
+void keep_process_resources(GameMemory * restored, const GameMemory * live){
+    keep_renderer_objects(&restored->game_renderer, &live->game_renderer);
+    keep_renderer_objects(&restored->static_ui_renderer, &live->static_ui_renderer);
+    restored->plain_texture = live->plain_texture;
+    restored->quad_shader = live->quad_shader;
+    restored->render_state = live->render_state;
+    restored->upload_pbo = live->upload_pbo;
+
+    // the atlas is built from the asset files, not from the game state
+    restored->atlas_texture = live->atlas_texture;
+    restored->atlas = live->atlas;
+    restored->white_rect = live->white_rect;
+    memcpy(restored->sprite_sheets, live->sprite_sheets, sizeof(live->sprite_sheets));
+    restored->sprite_sheet_count = live->sprite_sheet_count;
+    restored->atlas_load = live->atlas_load;
+    restored->max_texture_size = live->max_texture_size;
+
+    restored->temporary = live->temporary;
+    memcpy(restored->scratch, live->scratch, sizeof(live->scratch));
+}
+
+// called by the platform between frames with the render thread idle
+extern "C"
+int gamespace_snapshot_function(MemoryBlock * gspace_mem, MemorySnapshot * snapshot){
+    PROFILE_FUNCTION();
+    GameMemory * pointer = GET_ALIGNMENT_POINTER(gspace_mem->ptr, GameMemory);
+    return save_memory_snapshot(snapshot, gspace_mem, game_state_size(gspace_mem, pointer));
+}
+
+// @note: the live GameMemory is parked on the temporary stack, which is 
+//        past the end of the snapshot, while the block is overwritten. the
+//        first update after a restore starts the frame timing again, time
+//        does not jump by however long ago the snapshot was taken
+extern "C"
+int gamespace_restore_function(MemoryBlock * gspace_mem, const MemorySnapshot * snapshot){
+    PROFILE_FUNCTION();
+    GameMemory * pointer = GET_ALIGNMENT_POINTER(gspace_mem->ptr, GameMemory);
+
+    STACK_SCOPE(&pointer->temporary);
+    GameMemory * live = PUSH_IN_STACK(&pointer->temporary, GameMemory, 1);
+    if (live == nullptr) return -1;
+    *live = *pointer;
+
+    if (restore_memory_snapshot(snapshot, gspace_mem)){
+        *pointer = *live;
+        return -1;
+    }
+    keep_process_resources(pointer, live);
+    pointer->previous_ticks = 0;
+    return 0;
+}
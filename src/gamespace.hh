@@ -5,8 +5,11 @@
 #include <glm/glm.hpp>
 
 #include "memory.hh"
+#include "pool.hh"
+#include "platform.hh"
 
 #include "physics.hh"
+#include "atlas.hh"
 
 struct Renderer2D {
     float * mem_vertex_buffer = 0;
@@ -35,17 +38,151 @@ struct Renderer2D {
     int state = 0;
 };
 
+// render commands, recorded by the gamespace update into the frame command
+// arena handed out by the platform and replayed by gamespace_render_function
+// on the render thread. buffer contents are copied into the command arena so
+// the renderer memory can be reused for the next batch right away
+
+#define RENDER_COMMAND_UPLOAD       1
+#define RENDER_COMMAND_DRAW         2
+#define RENDER_COMMAND_BEGIN_PASS   3
+#define RENDER_COMMAND_END_PASS     4
+#define RENDER_COMMAND_TEXTURE_UPLOAD 5
+#define RENDER_COMMAND_RELOAD_SHADER  6
+
+struct RenderCommand {
+    unsigned int type;
+    RenderCommand * next;
+    void * data;
+};
+
+struct RenderCommandList {
+    RenderCommand * first;
+    RenderCommand * last;
+};
+
+struct RenderCommandUpload {
+    GLuint vbo, cbo, uvo, ibo;
+
+    float * vertices;
+    float * colors;
+    float * uv_coords;
+    unsigned int * indices;
+
+    size_t vertex_count;
+    size_t color_count;
+    size_t uv_coord_count;
+    size_t index_count;
+};
+
+// linked program with every location it uses resolved once at link time,
+// the projection uploaded last is kept so identical uploads can be skipped
+struct ShaderProgram {
+    GLuint id;
+
+    GLint projection_location;
+    GLint texture_location;
+
+    glm::mat4 uploaded_projection;
+    bool      projection_uploaded;
+};
+
+// GL bindings as last set by the render thread, reset at the start of every
+// frame because ImGui and the platform touch the same state in between
+struct RenderStateCache {
+    GLuint program;
+    GLuint texture;
+    GLuint vao;
+};
+
+// every quad program is a variant of one shader source, the feature bits of
+// a variant become #defines in front of it. variants are only built once a
+// draw asks for them, by the render thread that owns the source afterwards
+#define SHADER_FEATURE_TEXTURED      (1 << 0)
+#define SHADER_FEATURE_VERTEX_COLOR  (1 << 1)
+#define SHADER_FEATURE_PROJECTION    (1 << 2)
+#define SHADER_FEATURE_ALPHA_TEST    (1 << 3)
+#define SHADER_FEATURE_INSTANCING    (1 << 4)
+
+#define SHADER_VARIANT_COUNT         (1 << 5)
+
+struct ShaderPermutations {
+    char * source;
+    ShaderProgram variants[SHADER_VARIANT_COUNT];
+    // variants that did not build are not retried until the source changes
+    bool failed[SHADER_VARIANT_COUNT];
+};
+
+// new source for every variant, see reload_changed_shaders
+struct RenderCommandReloadShader {
+    char * source;
+};
+
+struct Texture2D;
+
+struct RenderCommandDraw {
+    GLuint vao;
+    GLuint ibo;
+    unsigned int features;
+    // nullptr for variants without SHADER_FEATURE_TEXTURED
+    const Texture2D * texture;
+    glm::mat4 projection;
+    size_t index_count;
+};
+
+// state and id of a streamed texture are written by the render thread, the
+// draws fall back to the placeholder texture until it is resident
+#define TEXTURE_STATE_EMPTY     0
+#define TEXTURE_STATE_RESIDENT  1
+
 struct Texture2D{
     GLuint          id;
     unsigned int    width;
     unsigned int    height;
     unsigned int    components;
+    unsigned int    state;
+};
+
+// rows [first_row, first_row + row_count) of a width * height rgba8 texture,
+// the texture storage is created by the first upload
+struct RenderCommandTextureUpload {
+    Texture2D * texture;
+    unsigned int width;
+    unsigned int height;
+    unsigned int first_row;
+    unsigned int row_count;
+    unsigned char * pixels;
+};
+
+#define TEXTURE_UPLOAD_BYTES_PER_FRAME  MB(2)
+// the atlas is packed as if for a GL 4 driver when there is no context to ask
+#define HEADLESS_MAX_TEXTURE_SIZE       8192
+
+#define ATLAS_LOAD_IDLE         0
+#define ATLAS_LOAD_DECODING     1
+#define ATLAS_LOAD_UPLOADING    2
+
+struct TextureAtlasLoad {
+    unsigned int state;
+    // platform image request of every sprite sheet source
+    int requests[ATLAS_MAX_SHEETS];
+
+    // composed atlas, kept until every row has been recorded for upload
+    unsigned char * pixels;
+    unsigned int next_row;
 };
 
+// cells of a sheet packed into the texture atlas, cell (x, y) of the sheet
+// is cells[x + y * x_max] and its tile id is atlas first_cell + x + y * x_max.
+// sheets described by metadata are a single row of x_max cells
 struct SpriteSheet{
     Texture2D * texture;
     unsigned int x_max;
     unsigned int y_max;
+
+    unsigned int atlas_sheet;
+    const AtlasRect * cells;
+    unsigned int first_cell;
 };
 
 struct SpriteTextureInfo{
@@ -65,10 +202,11 @@ struct StaticWorldInformation{
 struct LevelEditor{ 
     StaticWorldInformation world_info;
 
-    // note: this will later become a list of sprite-sheets 
-    // for now this is a single one
+    // sheet currently shown in the selection gui, the placed tiles store 
+    // atlas cell ids so the level can mix any of the loaded sheets
 
     SpriteSheet * sprite;
+    unsigned int selected_sheet;
 
     float per_sprite_width;
     float per_sprite_height;
@@ -96,8 +234,11 @@ struct Camera2D {
 
 #define MAX_COLLIDER_COUNT   128
 
+#define SCRATCH_ARENA_COUNT  (MAX_WORKER_THREADS + 1)
+#define SCRATCH_ARENA_SIZE   MB(16)
+
 struct Player {
-    unsigned int box_collider_idx;
+    PoolHandle box_collider;
 };
 
 
@@ -106,22 +247,40 @@ struct GameMemory{
     Renderer2D static_ui_renderer;
     LevelEditor level_editor;
     Texture2D plain_texture;
-    Texture2D tile_texture;
+    Texture2D atlas_texture;
 
     Camera2D camera;
 
     glm::mat4 static_ortho_projection;
 
-    SpriteSheet sprite_sheet;
+    TextureAtlas atlas;
+    // opaque white texel of the atlas, flat colored quads are drawn with it
+    // so they can share the draw with textured ones
+    AtlasRect white_rect;
+
+    SpriteSheet sprite_sheets[ATLAS_MAX_SHEETS];
+    unsigned int sprite_sheet_count;
+
+    TextureAtlasLoad atlas_load;
+    unsigned int max_texture_size;
 
     MemoryArena permanent;
     MemoryStackAllocator temporary;
 
+    // one scratch stack per platform_thread_index, for the main thread and
+    // the workers of platform_run_parallel, all released together at the 
+    // end of the frame
+    MemoryStackAllocator scratch[SCRATCH_ARENA_COUNT];
+
     float xresolution;
     float yresolution;
 
     int current_ui;
-    GLint  p1, p2, p3, p4;
+    ShaderPermutations quad_shader;
+
+    // only touched by the render thread
+    RenderStateCache render_state;
+    GLuint upload_pbo;
 
     // physics debiging starts
 
@@ -139,14 +298,17 @@ struct GameMemory{
 
     Player  player;
 
-    BoxCollider colliders[MAX_COLLIDER_COUNT];
-    unsigned int collider_count;
+    // the live colliders are packed in colliders.items[0, colliders.count)
+    Pool<BoxCollider> colliders;
 
     unsigned int previous_ticks;
 };
 
 typedef void (*gamespace_update_function_t)(MemoryBlock * block);
 typedef void (*gamespace_init_function_t)(MemoryBlock * block);
+typedef void (*gamespace_render_function_t)(MemoryBlock * block, MemoryArena * commands);
+typedef int  (*gamespace_snapshot_function_t)(MemoryBlock * block, MemorySnapshot * snapshot);
+typedef int  (*gamespace_restore_function_t)(MemoryBlock * block, const MemorySnapshot * snapshot);
 
 
 #endif
@@ -0,0 +1,139 @@
+#include "gpu_profiler.hh"
+
+#include <imgui.h>
+
+#include <cstdio>
+#include <cstring>
+
+GpuProfiler g_gpu_profiler = {};
+
+static const char * gpu_pass_names[GPU_PASS_COUNT] = {
+    "world",
+    "game elements",
+    "tile editor",
+    "ui",
+    "imgui",
+};
+
+void gpu_profiler_init(){
+    glGenQueries(GPU_PROFILER_LATENCY * GPU_PASS_COUNT, &g_gpu_profiler.queries[0][0]);
+    memset(g_gpu_profiler.issued, 0, sizeof(g_gpu_profiler.issued));
+    g_gpu_profiler.frame = 0;
+    g_gpu_profiler.active_pass = -1;
+    memset(g_gpu_profiler.history_head, 0, sizeof(g_gpu_profiler.history_head));
+    memset(g_gpu_profiler.history_count, 0, sizeof(g_gpu_profiler.history_count));
+    g_gpu_profiler.lock = SDL_CreateMutex();
+    g_gpu_profiler.initialized = true;
+}
+
+void gpu_profiler_begin_frame(){
+    GpuProfiler * profiler = &g_gpu_profiler;
+    if (profiler->initialized == false) return;
+
+    profiler->frame += 1;
+    unsigned int slot = profiler->frame % GPU_PROFILER_LATENCY;
+
+    // the queries of this slot were issued GPU_PROFILER_LATENCY frames ago,
+    // a result that is still not available is dropped instead of waited on
+    float sample[GPU_PASS_COUNT] = {};
+    bool valid[GPU_PASS_COUNT] = {};
+    bool any_valid = false;
+    for(unsigned int pass = 0 ; pass < GPU_PASS_COUNT ; pass++){
+        if (profiler->issued[slot][pass] == false) continue;
+        profiler->issued[slot][pass] = false;
+
+        GLuint available = 0;
+        glGetQueryObjectuiv(profiler->queries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == 0) continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(profiler->queries[slot][pass], GL_QUERY_RESULT, &elapsed);
+        sample[pass] = (float) ((double) elapsed / 1000000.0);
+        valid[pass] = true;
+        any_valid = true;
+    }
+    if (any_valid == false) return;
+
+    SDL_LockMutex(profiler->lock);
+    for(unsigned int pass = 0 ; pass < GPU_PASS_COUNT ; pass++){
+        if (valid[pass] == false) continue;
+        profiler->history[pass][profiler->history_head[pass]] = sample[pass];
+        profiler->history_head[pass] = (profiler->history_head[pass] + 1) % GPU_PROFILER_HISTORY;
+        if (profiler->history_count[pass] < GPU_PROFILER_HISTORY) profiler->history_count[pass] += 1;
+    }
+    SDL_UnlockMutex(profiler->lock);
+}
+
+void gpu_profiler_begin_pass(unsigned int pass){
+    GpuProfiler * profiler = &g_gpu_profiler;
+    if (profiler->initialized == false || pass >= GPU_PASS_COUNT) return;
+
+    // time elapsed queries can not nest, an open pass is closed first
+    if (profiler->active_pass != -1) gpu_profiler_end_pass();
+
+    unsigned int slot = profiler->frame % GPU_PROFILER_LATENCY;
+    if (profiler->issued[slot][pass]){
+        printf("gpu profiler :: pass %s issued twice in one frame\n", gpu_pass_names[pass]);
+        return;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, profiler->queries[slot][pass]);
+    profiler->issued[slot][pass] = true;
+    profiler->active_pass = (int) pass;
+}
+
+void gpu_profiler_end_pass(){
+    GpuProfiler * profiler = &g_gpu_profiler;
+    if (profiler->active_pass == -1) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    profiler->active_pass = -1;
+}
+
+void gpu_profiler_draw_panel(){
+    GpuProfiler * profiler = &g_gpu_profiler;
+
+    ImGui::Begin("GPU passes");
+    if (profiler->initialized == false){
+        ImGui::Text("no GL context, nothing is measured");
+        ImGui::End();
+        return;
+    }
+
+    // the samples of every pass are copied out oldest first so the plots
+    // scroll, passes with fewer samples draw shorter plots
+    float history[GPU_PASS_COUNT][GPU_PROFILER_HISTORY];
+    unsigned int count[GPU_PASS_COUNT];
+    SDL_LockMutex(profiler->lock);
+    for(unsigned int pass = 0 ; pass < GPU_PASS_COUNT ; pass++){
+        count[pass] = profiler->history_count[pass];
+        unsigned int first = (profiler->history_head[pass] + GPU_PROFILER_HISTORY - count[pass]) % GPU_PROFILER_HISTORY;
+        for(unsigned int i = 0 ; i < count[pass] ; i++){
+            history[pass][i] = profiler->history[pass][(first + i) % GPU_PROFILER_HISTORY];
+        }
+    }
+    SDL_UnlockMutex(profiler->lock);
+
+    float total = 0.0f;
+    for(unsigned int pass = 0 ; pass < GPU_PASS_COUNT ; pass++){
+        ImGui::Text("%s", gpu_pass_names[pass]);
+        if (count[pass] == 0){
+            ImGui::Text("no samples");
+            continue;
+        }
+
+        float average = 0.0f;
+        float peak = 0.0f;
+        for(unsigned int i = 0 ; i < count[pass] ; i++){
+            average += history[pass][i];
+            peak = history[pass][i] > peak ? history[pass][i] : peak;
+        }
+        average /= count[pass];
+        total += average;
+
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "avg %.3f ms  max %.3f ms", average, peak);
+        ImGui::PlotLines(gpu_pass_names[pass], history[pass], (int) count[pass], 0, overlay, 0.0f, peak > 0.0f ? peak * 1.2f : 1.0f, ImVec2(0, 40));
+    }
+    ImGui::Separator();
+    ImGui::Text("total gpu time   : %.3f ms", total);
+    ImGui::End();
+}
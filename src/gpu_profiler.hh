@@ -0,0 +1,52 @@
+#ifndef GPU_PROFILER_HH
+#define GPU_PROFILER_HH
+
+#include <GL/glew.h>
+#include <SDL2/SDL.h>
+
+// GPU time per render pass measured with GL_TIME_ELAPSED queries. results are
+// read back GPU_PROFILER_LATENCY frames later, and only once they are 
+// available, so the render thread never stalls on the query results
+
+#define GPU_PASS_WORLD              0
+#define GPU_PASS_GAME_ELEMENTS      1
+#define GPU_PASS_TILE_EDITOR        2
+#define GPU_PASS_UI                 3
+#define GPU_PASS_IMGUI              4
+#define GPU_PASS_COUNT              5
+
+#define GPU_PROFILER_LATENCY        4
+#define GPU_PROFILER_HISTORY        128
+
+struct GpuProfiler {
+    GLuint queries[GPU_PROFILER_LATENCY][GPU_PASS_COUNT];
+    bool   issued[GPU_PROFILER_LATENCY][GPU_PASS_COUNT];
+
+    unsigned int frame;
+    int active_pass;
+    bool initialized;
+
+    // milliseconds per pass, written by the render thread and read by the
+    // debug panel on the main thread under the lock. every pass has its own
+    // ring that only gets the results that were actually read back, a pass
+    // that was skipped or whose query was not ready leaves no sample
+    SDL_mutex * lock;
+    float history[GPU_PASS_COUNT][GPU_PROFILER_HISTORY];
+    unsigned int history_head[GPU_PASS_COUNT];
+    unsigned int history_count[GPU_PASS_COUNT];
+};
+
+// main thread with the GL context current, before the render thread starts.
+// the queries and the lock are only written here, so the panel can read
+// them without any synchronisation
+void gpu_profiler_init();
+
+// render thread, needs the GL context
+void gpu_profiler_begin_frame();
+void gpu_profiler_begin_pass(unsigned int pass);
+void gpu_profiler_end_pass();
+
+// main thread
+void gpu_profiler_draw_panel();
+
+#endif
@@ -11,9 +11,13 @@
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
 
+#include <cstring>
+
 #include "platform.hh"
 #include "memory.hh"
 #include "gamespace.hh"
+#include "profiler.hh"
+#include "perf_counters.hh"
 
 /* Platform specific code */
 #include <dlfcn.h>
@@ -23,6 +27,22 @@
 
 
 
+#define GAMESPACE_RESERVE_SIZE  GB(16)
+#define PROFILER_MEMORY_SIZE    MB(16)
+// fixed so that snapshot files written by one run point into the block of
+// the next one, see MemorySnapshot
+#define GAMESPACE_BASE_ADDRESS  ((void *) GB(4096))
+
+#define GAMESPACE_SNAPSHOT_COUNT 4
+#define GAMESPACE_SNAPSHOT_FILE  "gamespace.snapshot"
+#define GAMESPACE_RECORDING_FILE "gamespace.input"
+
+#define WINDOW_WIDTH            1200
+#define WINDOW_HEIGHT           900
+// simulated frame length and run length of --headless unless given
+#define HEADLESS_FRAME_MS       16
+#define HEADLESS_FRAME_COUNT    1000
+
 // Tasks 
 // 1. Setting up SDL2 and OPENGL build with cmake 
 // 2. Setting up DearIMGUI build with cmake
@@ -33,6 +53,9 @@ struct GamespaceLibrary{
 
     gamespace_init_function_t   gspace_init_func            = 0 ;
     gamespace_update_function_t gspace_update_func          = 0 ;
+    gamespace_render_function_t gspace_render_func          = 0 ;
+    gamespace_snapshot_function_t gspace_snapshot_func      = 0 ;
+    gamespace_restore_function_t gspace_restore_func        = 0 ;
 };
 
 
@@ -54,6 +77,24 @@ int load_library(GamespaceLibrary * lib) {
         printf("unable to load function gamespace_update_function: %s\n", dlerror()); 
         return -1; 
     }
+
+    lib->gspace_render_func= (gamespace_render_function_t) dlsym(lib->handle, "gamespace_render_function");
+    if(!lib->gspace_render_func){ 
+        printf("unable to load function gamespace_render_function: %s\n", dlerror()); 
+        return -1; 
+    }
+
+    lib->gspace_snapshot_func = (gamespace_snapshot_function_t) dlsym(lib->handle, "gamespace_snapshot_function");
+    if(!lib->gspace_snapshot_func){
+        printf("unable to load function gamespace_snapshot_function: %s\n", dlerror());
+        return -1;
+    }
+
+    lib->gspace_restore_func = (gamespace_restore_function_t) dlsym(lib->handle, "gamespace_restore_function");
+    if(!lib->gspace_restore_func){
+        printf("unable to load function gamespace_restore_function: %s\n", dlerror());
+        return -1;
+    }
     return 0;
 }
 
@@ -79,34 +120,243 @@ int reload_library(GamespaceLibrary * lib){
 }
 
 
-int main(int argc, char ** argv) {
+// F1-F4 save the game state into the in memory slots and F5-F8 go back to
+// them, F9 writes the state to GAMESPACE_SNAPSHOT_FILE for --restore
+void update_snapshots(GamespaceLibrary * lib, MemoryBlock * gspace_mem, MemorySnapshot * snapshots){
+    const int save_keys[GAMESPACE_SNAPSHOT_COUNT]    = { SDLK_F1, SDLK_F2, SDLK_F3, SDLK_F4 };
+    const int restore_keys[GAMESPACE_SNAPSHOT_COUNT] = { SDLK_F5, SDLK_F6, SDLK_F7, SDLK_F8 };
+
+    for(unsigned int i = 0 ; i < GAMESPACE_SNAPSHOT_COUNT ; i++){
+        if (is_live_key_pressed(save_keys[i])){
+            platform_wait_render_idle();
+            if (lib->gspace_snapshot_func(gspace_mem, snapshots + i) == 0){
+                printf("game state saved to slot %u (%lu KB)\n", i + 1, snapshots[i].size / KB(1));
+            }
+        }
+        if (is_live_key_pressed(restore_keys[i])){
+            if (snapshots[i].data == nullptr){
+                printf("snapshot slot %u is empty\n", i + 1);
+                continue;
+            }
+            platform_wait_render_idle();
+            if (lib->gspace_restore_func(gspace_mem, snapshots + i) == 0){
+                printf("game state restored from slot %u\n", i + 1);
+            }
+        }
+    }
+
+    if (is_live_key_pressed(SDLK_F9)){
+        MemorySnapshot file_snapshot = {};
+        platform_wait_render_idle();
+        if (lib->gspace_snapshot_func(gspace_mem, &file_snapshot) == 0 && write_memory_snapshot(&file_snapshot, GAMESPACE_SNAPSHOT_FILE) == 0){
+            printf("game state written to %s\n", GAMESPACE_SNAPSHOT_FILE);
+        }
+        release_memory_snapshot(&file_snapshot);
+    }
+}
+
+// @note: a recording is the input file and a snapshot of the game state at
+//        its first frame, written next to it as <file>.snapshot. playback 
+//        restores the snapshot and replays the frames, over and over, either
+//        all of them or [loop_first, loop_last). the state at loop_first is
+//        saved on the first pass. the game is restored right after any of
+//        these snapshots is taken, so the recording and every pass start 
+//        with the same zero time step that follows a restore
+struct InputSession {
+    char path[256];
+    MemorySnapshot start;
+    MemorySnapshot section;
+    bool section_saved;
+
+    unsigned int loop_first;
+    // 0 loops at the end of the recording
+    unsigned int loop_last;
+
+    unsigned int pass;
+    Uint64 pass_begin;
+};
+
+int snapshot_and_restore(GamespaceLibrary * lib, MemoryBlock * gspace_mem, MemorySnapshot * snapshot){
+    platform_wait_render_idle();
+    if (lib->gspace_snapshot_func(gspace_mem, snapshot)) return -1;
+    return lib->gspace_restore_func(gspace_mem, snapshot);
+}
+
+void snapshot_path(const InputSession * session, char * path, size_t size){
+    snprintf(path, size, "%s.snapshot", session->path);
+}
+
+int start_recording(GamespaceLibrary * lib, MemoryBlock * gspace_mem, InputSession * session){
+    char path[sizeof(session->path) + 16];
+    snapshot_path(session, path, sizeof(path));
+    if (snapshot_and_restore(lib, gspace_mem, &session->start)) return -1;
+    if (write_memory_snapshot(&session->start, path)) return -1;
+    if (platform_begin_input_recording(session->path)) return -1;
+    printf("recording input to %s\n", session->path);
+    return 0;
+}
+
+int start_playback(GamespaceLibrary * lib, MemoryBlock * gspace_mem, InputSession * session){
+    char path[sizeof(session->path) + 16];
+    snapshot_path(session, path, sizeof(path));
+    if (read_memory_snapshot(&session->start, path)) return -1;
+    if (platform_begin_input_playback(session->path)) return -1;
+
+    platform_wait_render_idle();
+    if (lib->gspace_restore_func(gspace_mem, &session->start)){
+        platform_end_input();
+        return -1;
+    }
+    session->section_saved = false;
+    session->pass = 0;
+    session->pass_begin = SDL_GetPerformanceCounter();
+    printf("playing back %u frames of %s\n", platform_input_frame_count(), session->path);
+    return 0;
+}
+
+// called before the input of a frame is read, jumps back to the start of the
+// section once its last frame has been played
+void update_playback(GamespaceLibrary * lib, MemoryBlock * gspace_mem, InputSession * session){
+    if (platform_input_mode() != INPUT_PLAYBACK) return;
 
+    unsigned int frame = platform_input_frame();
+    unsigned int first = session->loop_first;
+    unsigned int last = session->loop_last;
+    if (last == 0 || last > platform_input_frame_count()) last = platform_input_frame_count();
+    if (first >= last) first = 0;
 
-    printf("Memory stack allocator test starts\n");
+    if (frame == first && first > 0 && session->section_saved == false){
+        if (snapshot_and_restore(lib, gspace_mem, &session->section) == 0) session->section_saved = true;
+        session->pass_begin = SDL_GetPerformanceCounter();
+    }
+    if (frame < last) return;
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    double milliseconds = (now - session->pass_begin) * 1000.0 / SDL_GetPerformanceFrequency();
+    printf("playback pass %u : frames %u - %u in %.2f ms, %.3f ms per frame\n",
+            session->pass, first, last, milliseconds, milliseconds / (last - first));
+    session->pass += 1;
+    session->pass_begin = now;
+
+    MemorySnapshot * snapshot = (first > 0 && session->section_saved) ? &session->section : &session->start;
+    if (snapshot == &session->start) first = 0;
+    platform_wait_render_idle();
+    lib->gspace_restore_func(gspace_mem, snapshot);
+    platform_seek_input(first);
+}
 
-    MemoryStackAllocator sa =  {};
-    void * buffer = 0;
-    init_stack_allocator(&sa, buffer, 10);
-    void * first = push_in_stack(&sa, 2, 1);
-    assert(first == (void *) 0x00);
-    void * second = push_in_stack(&sa, 4, 4);
-    assert(second == (void *) 0x04);
-    void * third = push_in_stack(&sa, 2, 1);
-    assert(third == (void *) 0x08);
-    pop_from_stack(&sa);
-    void * fourth = push_in_stack(&sa, 3, 1);
-    assert(fourth == nullptr);
+// F10 starts and stops recording, F11 starts and stops playback
+void update_input_session(GamespaceLibrary * lib, MemoryBlock * gspace_mem, InputSession * session){
+    if (is_live_key_pressed(SDLK_F10)){
+        if (platform_input_mode() == INPUT_RECORDING) {
+            platform_end_input();
+        } else if (start_recording(lib, gspace_mem, session)){
+            printf("unable to start recording %s\n", session->path);
+        }
+    }
+    if (is_live_key_pressed(SDLK_F11)){
+        if (platform_input_mode() == INPUT_PLAYBACK) {
+            platform_end_input();
+        } else if (start_playback(lib, gspace_mem, session)){
+            printf("unable to play back %s\n", session->path);
+        }
+    }
+}
 
-    printf("Memory stack allocator test ends\n");
+// wall time of every frame of a run with a frame limit, reported at exit
+struct FrameTimings {
+    double * milliseconds;
+    unsigned int count;
+    unsigned int capacity;
+};
 
+int compare_doubles(const void * a, const void * b){
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
 
-    printf("Memory arena allocator test starts\n");
-    // @todo(nitesh) : adds the arena based allocator tests in herre as well 
-    printf("Memory arena allocator test ends\n");
+// @note: prints the distribution of the frame times, and writes every frame
+//        time to a csv when a path is given so batch jobs can keep them
+void report_frame_timings(FrameTimings * timings, const char * csv_path){
+    if (timings->count == 0) return;
+
+    if (csv_path){
+        FILE * file = fopen(csv_path, "w");
+        if (file){
+            fprintf(file, "frame,milliseconds\n");
+            for(unsigned int i = 0 ; i < timings->count ; i++) fprintf(file, "%u,%.4f\n", i, timings->milliseconds[i]);
+            fclose(file);
+        } else {
+            printf("unable to write frame timings to %s\n", csv_path);
+        }
+    }
+
+    double total = 0.0;
+    for(unsigned int i = 0 ; i < timings->count ; i++) total += timings->milliseconds[i];
+    qsort(timings->milliseconds, timings->count, sizeof(double), compare_doubles);
+
+    const double * sorted = timings->milliseconds;
+    unsigned int last = timings->count - 1;
+    printf("frames : %u in %.2f ms, %.1f frames per second\n", timings->count, total, timings->count * 1000.0 / total);
+    printf("frame ms : min %.3f  avg %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f\n",
+            sorted[0], total / timings->count,
+            sorted[last * 50 / 100], sorted[last * 95 / 100], sorted[last * 99 / 100], sorted[last]);
+}
+
+int main(int argc, char ** argv) {
+
+    bool render_thread = true;
+    bool perf_counters = false;
+    unsigned int memory_flags = 0;
+    const char * restore_file = nullptr;
+    int input_mode = INPUT_IDLE;
+    InputSession session = {};
+    strcpy(session.path, GAMESPACE_RECORDING_FILE);
+    bool headless = false;
+    unsigned int frame_ms = HEADLESS_FRAME_MS;
+    unsigned int frame_limit = 0;
+    const char * report_file = nullptr;
+    for(int i = 1 ; i < argc ; i++){
+        if (strcmp(argv[i], "--no-render-thread") == 0) render_thread = false;
+        if (strcmp(argv[i], "--perf-counters") == 0)    perf_counters = true;
+        if (strcmp(argv[i], "--huge-pages") == 0)       memory_flags |= MEMORY_HUGE_PAGES;
+        if (strcmp(argv[i], "--prefault") == 0)         memory_flags |= MEMORY_PREFAULT;
+        if (strcmp(argv[i], "--restore") == 0){
+            // the file is optional, a following flag is not taken as its name
+            bool has_path = i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0;
+            restore_file = has_path ? argv[++i] : GAMESPACE_SNAPSHOT_FILE;
+        }
+        if (strcmp(argv[i], "--record") == 0)           input_mode = INPUT_RECORDING;
+        if (strcmp(argv[i], "--playback") == 0)         input_mode = INPUT_PLAYBACK;
+        if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) snprintf(session.path, sizeof(session.path), "%s", argv[++i]);
+        if (strcmp(argv[i], "--loop") == 0 && i + 1 < argc)  sscanf(argv[++i], "%u:%u", &session.loop_first, &session.loop_last);
+        if (strcmp(argv[i], "--headless") == 0)         headless = true;
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)   frame_limit = atoi(argv[++i]);
+        if (strcmp(argv[i], "--frame-ms") == 0 && i + 1 < argc) frame_ms = atoi(argv[++i]);
+        if (strcmp(argv[i], "--report") == 0 && i + 1 < argc)   report_file = argv[++i];
+    }
+    if (headless && frame_limit == 0) frame_limit = HEADLESS_FRAME_COUNT;
+
+
+    // the profiler rings live in a block of their own so recorded zones
+    // survive reloads and restores of the gamespace. threads register on
+    // their first zone, so this has to happen before platform init starts
+    // the workers and the image loader
+    MemoryBlock profiler_mem = {0};
+    if (reserve_memory_block(&profiler_mem, PROFILER_MEMORY_SIZE, memory_flags) == 0 &&
+        commit_memory(profiler_mem.ptr, profiler_mem.size, profiler_mem.flags) == 0){
+        profiler_init(&profiler_mem);
+        profiler_set_thread_name("main");
+    }
 
-            
-    // end mem test
-    platform_init("main window", 1200, 900, SDL_WINDOW_OPENGL);
+    // headless runs have no window or GL context and are not frame locked,
+    // the gamespace simulates and records its render commands as usual
+    if (headless){
+        platform_init_headless(WINDOW_WIDTH, WINDOW_HEIGHT, frame_ms);
+    } else {
+        platform_init("main window", WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_OPENGL);
+    }
 
     GamespaceLibrary lib = {0};
     if (load_library(&lib)) {
@@ -114,33 +364,104 @@ int main(int argc, char ** argv) {
         return -1;
     }
 
+    // only address space, the gamespace commits pages as it uses them
     MemoryBlock gspace_mem = {0};
-    gspace_mem.ptr = malloc(MB(50));
-    gspace_mem.size = MB(50);
+    if (reserve_memory_block(&gspace_mem, GAMESPACE_RESERVE_SIZE, memory_flags, GAMESPACE_BASE_ADDRESS)){
+        printf("unable to reserve gamespace memory\n");
+        return -1;
+    }
 
     lib.gspace_init_func(&gspace_mem);
 
+    // the GL objects and assets come from init, the game state from the file
+    if (restore_file){
+        MemorySnapshot file_snapshot = {};
+        if (read_memory_snapshot(&file_snapshot, restore_file) == 0 && lib.gspace_restore_func(&gspace_mem, &file_snapshot) == 0){
+            printf("game state restored from %s\n", restore_file);
+        } else {
+            printf("unable to restore %s, starting from a new game\n", restore_file);
+        }
+        release_memory_snapshot(&file_snapshot);
+    }
+    MemorySnapshot snapshots[GAMESPACE_SNAPSHOT_COUNT] = {};
+
     bool bvalue = false;
-    glClearDepth(1.0f);
+    if (headless == false) glClearDepth(1.0f);
+
+    // everything after this point talks to GL through the render commands
+    MemoryBlock render_command_mem = {0};
+    render_command_mem.ptr = malloc(MB(64));
+    render_command_mem.size = MB(64);
+    platform_init_render_thread(&render_command_mem, render_thread);
+
+    if (perf_counters) perf_counters_init();
+
+    if (input_mode == INPUT_RECORDING && start_recording(&lib, &gspace_mem, &session)){
+        printf("unable to start recording %s\n", session.path);
+    }
+    if (input_mode == INPUT_PLAYBACK && start_playback(&lib, &gspace_mem, &session)){
+        printf("unable to play back %s\n", session.path);
+    }
+
+    FrameTimings timings = {};
+    if (frame_limit){
+        timings.milliseconds = (double *) malloc(sizeof(double) * frame_limit);
+        timings.capacity = timings.milliseconds ? frame_limit : 0;
+    }
 
     unsigned int b = get_ticks_since_start();
     unsigned int delta = 0;
-    while(is_quit_requested() == false){
+    unsigned int frame_count = 0;
+    Uint64 frame_begin = SDL_GetPerformanceCounter();
+    while(is_quit_requested() == false && (frame_limit == 0 || frame_count < frame_limit)){
+        profiler_frame_mark();
+        update_playback(&lib, &gspace_mem, &session);
         platform_update_input_state();
         platform_begin_rendering();
 
         lib.gspace_update_func(&gspace_mem);
 
-        platform_end_rendering();
-        if (is_key_pressed(SDLK_r)){
+        platform_end_rendering(lib.gspace_render_func, &gspace_mem);
+        perf_counters_frame_end();
+        update_snapshots(&lib, &gspace_mem, snapshots);
+        update_input_session(&lib, &gspace_mem, &session);
+        if (is_live_key_pressed(SDLK_r)){
             unsigned int ticks   = get_ticks_since_start();
             unsigned int seconds  = ticks/1000;
             unsigned int minutes = seconds/60;
             unsigned int hours   = minutes/60;
             printf("[%02u:%02u:%02u] reloading library instance\n", hours, minutes, seconds);
+            PROFILE_SCOPE("reload library");
+            // the render thread may still be running code from the old library
+            platform_wait_render_idle();
             reload_library(&lib);
         }
+
+        Uint64 frame_end = SDL_GetPerformanceCounter();
+        if (timings.count < timings.capacity){
+            timings.milliseconds[timings.count++] = (frame_end - frame_begin) * 1000.0 / SDL_GetPerformanceFrequency();
+        }
+        frame_begin = frame_end;
+        frame_count += 1;
+    }
+    report_frame_timings(&timings, report_file);
+
+    // the headless run is also the check that the profiler is hooked up
+    int exit_code = 0;
+#ifdef BREAD_PROFILE
+    if (headless && profiler_event_count() == 0){
+        printf("profiler :: no zones were recorded\n");
+        exit_code = 1;
     }
+#endif
+
+    free(timings.milliseconds);
+    perf_counters_shutdown();
     platform_delete_all_data();
-    return 0;
+    for(unsigned int i = 0 ; i < GAMESPACE_SNAPSHOT_COUNT ; i++) release_memory_snapshot(snapshots + i);
+    release_memory_snapshot(&session.start);
+    release_memory_snapshot(&session.section);
+    release_memory_block(&gspace_mem);
+    release_memory_block(&profiler_mem);
+    return exit_code;
 }
@@ -4,6 +4,238 @@
 #include <cstring>
 #include <cstdlib>
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+///////////// VIRTUAL MEMORY ////////////////////////////////////////////
+
+static size_t round_up(size_t value, size_t granularity){
+    return (value + granularity - 1) / granularity * granularity;
+}
+
+// @note: explicit huge pages come from the hugetlbfs pool, which has to be
+//        able to back the whole block because a hugetlb page that can not be
+//        faulted in later is a SIGBUS and not an error we can handle. when 
+//        the pool is too small the block falls back to normal pages with 
+//        transparent huge pages requested, aligned so that they can be used
+int reserve_memory_block(MemoryBlock * block, size_t size, unsigned int flags, void * base){
+    const int map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    size = round_up(size, MEMORY_COMMIT_GRANULARITY);
+
+    void * ptr = MAP_FAILED;
+    if (flags & MEMORY_HUGE_PAGES){
+        ptr = mmap(base, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) printf("memory :: hugetlb pool too small, using transparent huge pages\n");
+    }
+
+    if (ptr == MAP_FAILED){
+        size_t padded = size + MEMORY_COMMIT_GRANULARITY;
+        char * mapping = (char *) mmap(base, padded, PROT_NONE, map_flags, -1, 0);
+        if (mapping == (char *) MAP_FAILED){
+            printf("memory :: unable to reserve %lu MB\n", size / MB(1));
+            return -1;
+        }
+        char * aligned = (char *) round_up((size_t) mapping, MEMORY_COMMIT_GRANULARITY);
+        if (aligned != mapping) munmap(mapping, aligned - mapping);
+        if (aligned + size != mapping + padded) munmap(aligned + size, mapping + padded - (aligned + size));
+        ptr = aligned;
+
+        if (flags & MEMORY_HUGE_PAGES) madvise(ptr, size, MADV_HUGEPAGE);
+    }
+
+    block->ptr = ptr;
+    block->size = size;
+    block->flags = flags | MEMORY_RESERVED;
+    return 0;
+}
+
+void release_memory_block(MemoryBlock * block){
+    if (block->ptr && (block->flags & MEMORY_RESERVED)) munmap(block->ptr, block->size);
+    *block = {};
+}
+
+// makes the pages covering [ptr, ptr + size) readable and writable, pages
+// that are already committed are left as they are
+int commit_memory(void * ptr, size_t size, unsigned int flags){
+    size_t page = (flags & MEMORY_HUGE_PAGES) ? MEMORY_COMMIT_GRANULARITY : (size_t) sysconf(_SC_PAGESIZE);
+    size_t begin = (size_t) ptr / page * page;
+    size_t end = round_up((size_t) ptr + size, page);
+
+    if (mprotect((void *) begin, end - begin, PROT_READ | PROT_WRITE)){
+        printf("memory :: unable to commit %lu KB\n", (end - begin) / KB(1));
+        return -1;
+    }
+
+    if (flags & MEMORY_PREFAULT){
+#ifdef MADV_POPULATE_WRITE
+        if (madvise((void *) begin, end - begin, MADV_POPULATE_WRITE) == 0) return 0;
+#endif
+        for(size_t address = begin ; address < end ; address += page){
+            *(volatile char *) address = *(volatile char *) address;
+        }
+    }
+    return 0;
+}
+
+// grows the committed part of an allocator so that the first `end` bytes 
+// after base can be used
+static int commit_until(void * base, size_t * committed, size_t end, size_t size, unsigned int flags){
+    size_t target = round_up(end, MEMORY_COMMIT_GRANULARITY);
+    if (target > size) target = size;
+    if (commit_memory((char *) base + *committed, target - *committed, flags)) return -1;
+    *committed = target;
+    return 0;
+}
+
+///////////// SNAPSHOTS ///////////////////////////////////////////////
+
+#define SNAPSHOT_MAGIC      0x50414e53  // "SNAP"
+#define SNAPSHOT_VERSION    1
+
+// a whole page so that the data is page aligned in the file and can be mapped
+struct SnapshotFileHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long base;
+    unsigned long long size;
+    char padding[4096 - 24];
+};
+
+static_assert(sizeof(SnapshotFileHeader) == 4096, "snapshot header has to be a page");
+
+// @note: the mapping is kept when it is large enough, taking a snapshot into
+//        the same slot every frame only costs the copy
+int save_memory_snapshot(MemorySnapshot * snapshot, const MemoryBlock * block, size_t size){
+    if (size > block->size){
+        printf("memory :: snapshot of %lu KB is larger than the block\n", size / KB(1));
+        return -1;
+    }
+
+    if (snapshot->mapping && (snapshot->data != snapshot->mapping || snapshot->mapping_size < size)){
+        release_memory_snapshot(snapshot);
+    }
+    if (snapshot->mapping == nullptr){
+        size_t mapping_size = round_up(size, MEMORY_COMMIT_GRANULARITY);
+        void * mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED){
+            printf("memory :: unable to map %lu MB for a snapshot\n", mapping_size / MB(1));
+            return -1;
+        }
+        snapshot->mapping = mapping;
+        snapshot->mapping_size = mapping_size;
+        snapshot->data = mapping;
+    }
+
+    memcpy(snapshot->data, block->ptr, size);
+    snapshot->base = block->ptr;
+    snapshot->size = size;
+    return 0;
+}
+
+int restore_memory_snapshot(const MemorySnapshot * snapshot, MemoryBlock * block){
+    if (snapshot->data == nullptr) return -1;
+    if (snapshot->base != block->ptr){
+        printf("memory :: snapshot taken at %p can not be restored at %p\n", snapshot->base, block->ptr);
+        return -1;
+    }
+    if (snapshot->size > block->size){
+        printf("memory :: snapshot is larger than the block\n");
+        return -1;
+    }
+    if (block->flags & MEMORY_RESERVED){
+        if (commit_memory(block->ptr, snapshot->size, block->flags)) return -1;
+    }
+    memcpy(block->ptr, snapshot->data, snapshot->size);
+    return 0;
+}
+
+void release_memory_snapshot(MemorySnapshot * snapshot){
+    if (snapshot->mapping) munmap(snapshot->mapping, snapshot->mapping_size);
+    *snapshot = {};
+}
+
+// @note: written to a temporary file that replaces the old one only once it
+//        is complete, a crash while saving keeps the previous snapshot
+int write_memory_snapshot(const MemorySnapshot * snapshot, const char * path){
+    if (snapshot->data == nullptr) return -1;
+
+    char temporary[4096];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    int fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1){
+        printf("memory :: unable to open %s\n", temporary);
+        return -1;
+    }
+
+    size_t file_size = sizeof(SnapshotFileHeader) + snapshot->size;
+    if (ftruncate(fd, file_size)){
+        printf("memory :: unable to resize %s\n", temporary);
+        close(fd);
+        return -1;
+    }
+    char * file = (char *) mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (file == (char *) MAP_FAILED){
+        printf("memory :: unable to map %s\n", temporary);
+        return -1;
+    }
+
+    SnapshotFileHeader * header = (SnapshotFileHeader *) file;
+    header->magic = SNAPSHOT_MAGIC;
+    header->version = SNAPSHOT_VERSION;
+    header->base = (unsigned long long) snapshot->base;
+    header->size = snapshot->size;
+    memcpy(file + sizeof(SnapshotFileHeader), snapshot->data, snapshot->size);
+
+    int result = msync(file, file_size, MS_SYNC);
+    munmap(file, file_size);
+    if (result || rename(temporary, path)){
+        printf("memory :: unable to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+int read_memory_snapshot(MemorySnapshot * snapshot, const char * path){
+    int fd = open(path, O_RDONLY);
+    if (fd == -1){
+        printf("memory :: unable to open %s\n", path);
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) || (size_t) info.st_size < sizeof(SnapshotFileHeader)){
+        printf("memory :: %s is not a snapshot\n", path);
+        close(fd);
+        return -1;
+    }
+
+    size_t file_size = info.st_size;
+    char * file = (char *) mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == (char *) MAP_FAILED){
+        printf("memory :: unable to map %s\n", path);
+        return -1;
+    }
+
+    const SnapshotFileHeader * header = (const SnapshotFileHeader *) file;
+    if (header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION || header->size > file_size - sizeof(SnapshotFileHeader)){
+        printf("memory :: %s is not a snapshot of this version\n", path);
+        munmap(file, file_size);
+        return -1;
+    }
+
+    release_memory_snapshot(snapshot);
+    snapshot->base = (void *) header->base;
+    snapshot->size = header->size;
+    snapshot->data = file + sizeof(SnapshotFileHeader);
+    snapshot->mapping = file;
+    snapshot->mapping_size = file_size;
+    return 0;
+}
+
+
 ///////////// AREAN BASED PERMANENT ALLOCATOR ///////////////////////////
 
 // TODO: getting offset of the pointer from this type
@@ -23,6 +255,184 @@ void * get_alignment_pointer(void * ptr, size_t size, size_t alignment){
     return base_ptr;
 }
 
+///////////// TAGS AND GUARD BANDS /////////////////////////////////////
+
+static MemoryStats g_memory_stats = {};
+static thread_local unsigned int t_memory_tag = MEMORY_TAG_UNTAGGED;
+
+static const char * memory_tag_names[MEMORY_TAG_COUNT] = {
+    "untagged",
+    "renderer",
+    "world",
+    "physics",
+    "assets",
+    "editor",
+};
+
+unsigned int memory_set_tag(unsigned int tag){
+    unsigned int previous = t_memory_tag;
+    t_memory_tag = tag < MEMORY_TAG_COUNT ? tag : MEMORY_TAG_UNTAGGED;
+    return previous;
+}
+
+const char * memory_tag_name(unsigned int tag){
+    return tag < MEMORY_TAG_COUNT ? memory_tag_names[tag] : "invalid";
+}
+
+// @note: every thread counts into its own block so a push never contends on
+//        a shared cache line, the blocks are summed when the stats are read.
+//        each block has a single writer, the relaxed accesses only keep the
+//        reads from other threads well defined. blocks start on a cache
+//        line of their own so neighbouring threads never share one
+#define MEMORY_STATS_MAX_THREADS  64
+#define MEMORY_CACHE_LINE_SIZE    64
+
+struct alignas(MEMORY_CACHE_LINE_SIZE) MemoryThreadCounters {
+    size_t arena_bytes[MEMORY_TAG_COUNT];
+    size_t arena_count[MEMORY_TAG_COUNT];
+    size_t frame_bytes[MEMORY_TAG_COUNT];
+    size_t frame_count[MEMORY_TAG_COUNT];
+};
+
+static MemoryThreadCounters g_thread_counters[MEMORY_STATS_MAX_THREADS];
+static unsigned int g_thread_counter_count = 0;
+static thread_local MemoryThreadCounters * t_counters = nullptr;
+
+// threads past the limit share the last block and may lose counts
+static MemoryThreadCounters * thread_counters(){
+    if (t_counters == nullptr){
+        unsigned int index = __atomic_fetch_add(&g_thread_counter_count, 1, __ATOMIC_RELAXED);
+        if (index >= MEMORY_STATS_MAX_THREADS) index = MEMORY_STATS_MAX_THREADS - 1;
+        t_counters = g_thread_counters + index;
+    }
+    return t_counters;
+}
+
+static void add_counter(size_t * counter, size_t value){
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+static size_t sum_counter(size_t (MemoryThreadCounters::*counter)[MEMORY_TAG_COUNT], unsigned int tag){
+    unsigned int count = __atomic_load_n(&g_thread_counter_count, __ATOMIC_RELAXED);
+    if (count > MEMORY_STATS_MAX_THREADS) count = MEMORY_STATS_MAX_THREADS;
+    size_t total = 0;
+    for(unsigned int i = 0 ; i < count ; i++) total += __atomic_load_n(&(g_thread_counters[i].*counter)[tag], __ATOMIC_RELAXED);
+    return total;
+}
+
+const MemoryStats * memory_stats(){
+    for(unsigned int i = 0 ; i < MEMORY_TAG_COUNT ; i++){
+        MemoryTagStats * stats = g_memory_stats.tags + i;
+        stats->arena_bytes = sum_counter(&MemoryThreadCounters::arena_bytes, i);
+        stats->arena_count = sum_counter(&MemoryThreadCounters::arena_count, i);
+        stats->frame_bytes = sum_counter(&MemoryThreadCounters::frame_bytes, i);
+        stats->frame_count = sum_counter(&MemoryThreadCounters::frame_count, i);
+    }
+    return &g_memory_stats;
+}
+
+static void count_arena_push(size_t size){
+    MemoryThreadCounters * counters = thread_counters();
+    add_counter(counters->arena_bytes + t_memory_tag, size);
+    add_counter(counters->arena_count + t_memory_tag, 1);
+}
+
+static void count_frame_push(size_t size){
+    MemoryThreadCounters * counters = thread_counters();
+    add_counter(counters->frame_bytes + t_memory_tag, size);
+    add_counter(counters->frame_count + t_memory_tag, 1);
+}
+
+// @note: only called between frames, when no thread is pushing
+void memory_stats_end_frame(){
+    memory_stats();
+    for(unsigned int i = 0 ; i < MEMORY_TAG_COUNT ; i++){
+        MemoryTagStats * stats = g_memory_stats.tags + i;
+        if (stats->frame_bytes > stats->frame_peak) stats->frame_peak = stats->frame_bytes;
+        stats->last_frame_bytes = stats->frame_bytes;
+    }
+    unsigned int count = __atomic_load_n(&g_thread_counter_count, __ATOMIC_RELAXED);
+    if (count > MEMORY_STATS_MAX_THREADS) count = MEMORY_STATS_MAX_THREADS;
+    for(unsigned int i = 0 ; i < count ; i++){
+        memset(g_thread_counters[i].frame_bytes, 0, sizeof(g_thread_counters[i].frame_bytes));
+        memset(g_thread_counters[i].frame_count, 0, sizeof(g_thread_counters[i].frame_count));
+    }
+}
+
+#ifdef BREAD_MEMORY_GUARDS
+#define GUARD_BAND_SIZE  MEMORY_GUARD_BAND_SIZE
+#else
+#define GUARD_BAND_SIZE  0
+#endif
+
+#define GUARD_BYTE  0xfd
+
+// written unaligned right after the pattern
+struct GuardBandFooter {
+    size_t previous;
+    unsigned int tag;
+};
+
+static_assert(MEMORY_GUARD_PATTERN_SIZE + sizeof(GuardBandFooter) <= MEMORY_GUARD_BAND_SIZE, "guard band too small");
+
+#ifdef BREAD_MEMORY_GUARDS
+static void write_guard_band(char * base, size_t offset, size_t * last_guard){
+    char * band = base + offset;
+    memset(band, GUARD_BYTE, MEMORY_GUARD_PATTERN_SIZE);
+    GuardBandFooter footer = { *last_guard, t_memory_tag };
+    memcpy(band + MEMORY_GUARD_PATTERN_SIZE, &footer, sizeof(footer));
+    *last_guard = offset + 1;
+}
+#endif
+
+// walks the chain from *link down to the first band below floor, which is
+// left in *link, and returns how many of the walked bands were overwritten
+static size_t check_guard_chain(char * base, size_t * link, size_t floor, const char * kind){
+    size_t damaged = 0;
+    size_t current = *link;
+    while(current && current - 1 >= floor){
+        char * band = base + current - 1;
+        bool intact = true;
+        for(unsigned int i = 0 ; i < MEMORY_GUARD_PATTERN_SIZE ; i++){
+            if ((unsigned char) band[i] != GUARD_BYTE) intact = false;
+        }
+        GuardBandFooter footer;
+        memcpy(&footer, band + MEMORY_GUARD_PATTERN_SIZE, sizeof(footer));
+        if (intact == false){
+            damaged += 1;
+            printf("memory :: %s guard band at offset %lu overwritten, allocation tagged %s\n", 
+                    kind, current - 1, memory_tag_name(footer.tag));
+        }
+
+        // links only ever point backwards, anything else is a broken footer
+        if (footer.previous >= current){
+            current = 0;
+            break;
+        }
+        current = footer.previous;
+    }
+    *link = current;
+    if (damaged) __atomic_fetch_add(&g_memory_stats.damaged_guards, damaged, __ATOMIC_RELAXED);
+    return damaged;
+}
+
+///////////// ARENA /////////////////////////////////////////////////////
+
+void init_arena(MemoryArena * arena, void * ptr, size_t size, unsigned int flags){
+    arena->ptr = ptr;
+    arena->size = size;
+    arena->cur = 0;
+    arena->committed = 0;
+    arena->flags = flags;
+    arena->padding = 0;
+    arena->last_guard = 0;
+}
+
+size_t check_arena_guards(MemoryArena * arena){
+    size_t link = arena->last_guard;
+    return check_guard_chain((char *) arena->ptr, &link, 0, "arena");
+}
+
 // TODO: how to handle memory clearing
 void * push_value_to_arena(MemoryArena * arena, size_t size, size_t alignment){
     void * result = 0;
@@ -36,74 +446,90 @@ void * push_value_to_arena(MemoryArena * arena, size_t size, size_t alignment){
     }
 
     // RETURNING FROM THIS POINT BECAUSE ARENA CAPACITY REACHED
-    if (offset + arena->cur + size > arena->size){
+    size_t end = offset + arena->cur + size + GUARD_BAND_SIZE;
+    if (end > arena->size){
         return NULL;
     }
 
+    if ((arena->flags & MEMORY_RESERVED) && end > arena->committed){
+        if (commit_until(arena->ptr, &arena->committed, end, arena->size, arena->flags)) return NULL;
+    }
+
     result = (void *) ((size_t) present_ptr + offset);
     arena->cur = arena->cur + (size_t) result - (size_t) present_ptr + size;
+#ifdef BREAD_MEMORY_GUARDS
+    write_guard_band(base_ptr, arena->cur, &arena->last_guard);
+    arena->cur += GUARD_BAND_SIZE;
+#endif
+    arena->padding += offset + GUARD_BAND_SIZE;
+    count_arena_push(size);
     return result;
 }
 
 // Stack based allocator
 
-void init_stack_allocator(MemoryStackAllocator * allocator, void * ptr, size_t size){
-    for(unsigned int i = 0 ; i < MAX_ALLOCATION ; i++){
-        allocator->allocations[i] = nullptr;
-    }
-    allocator->allocation_count = 0;
-
+void init_stack_allocator(MemoryStackAllocator * allocator, void * ptr, size_t size, unsigned int flags){
     allocator->base = ptr;
     allocator->size = size;
     allocator->used = 0;
+    allocator->committed = 0;
+    allocator->flags = flags;
+
+    allocator->high_water = 0;
+    allocator->frame_high_water = 0;
+    allocator->peak = 0;
+    allocator->last_guard = 0;
 }
 
 void * push_in_stack(MemoryStackAllocator * allocator, size_t size, size_t alignment){
-    // 1. check if there is space left for this allocation :: mem
-    // 2. check if there is slot left for this allocation  :: stack
-    
-    void * result = nullptr;
     void * current = (void *) ((char *) allocator->base + allocator->used);
-    size_t adjusted_size = size +  get_alignment_offset(current, size, alignment);
+    size_t adjusted_size = size +  get_alignment_offset(current, size, alignment) + GUARD_BAND_SIZE;
 
     if (adjusted_size > allocator->size - allocator->used){
         printf("ERROR: allocation failed, insufficient space in allocator\n");
         return nullptr;
     }
 
-    if (allocator->allocation_count == MAX_ALLOCATION){
-        printf("ERROR: allocation failed, insufficient slots in allocator\n");
-        return nullptr;
+    if ((allocator->flags & MEMORY_RESERVED) && allocator->used + adjusted_size > allocator->committed){
+        if (commit_until(allocator->base, &allocator->committed, allocator->used + adjusted_size, allocator->size, allocator->flags)) return nullptr;
     }
 
-    allocator->allocations[allocator->allocation_count] = current;
-    allocator->allocation_count += 1;
-
-    result = get_alignment_pointer(current, size, alignment);
+    void * result = get_alignment_pointer(current, size, alignment);
     allocator->used += adjusted_size;
+    if (allocator->used > allocator->high_water) allocator->high_water = allocator->used;
+#ifdef BREAD_MEMORY_GUARDS
+    write_guard_band((char *) allocator->base, allocator->used - GUARD_BAND_SIZE, &allocator->last_guard);
+#endif
+    count_frame_push(size);
 
     return result;
 }
 
-
-// @note: check if we can do memset here as well, for data sanity
-
-void pop_from_stack(MemoryStackAllocator * allocator){
-
-    if (allocator->allocation_count == 0){
-        printf("ERROR : deallocation called before allocation\n");
-        return;
-    }
-
-    void * top = allocator->allocations[allocator->allocation_count - 1];
-    allocator->used = (char *) top - (char *) allocator->base;
-    allocator->allocation_count -= 1;
+// the guard bands of everything released are checked on the way
+void restore_stack_marker(MemoryStackAllocator * allocator, MemoryStackMarker marker){
+    if (marker >= allocator->used) return;
+#ifdef BREAD_MEMORY_GUARDS
+    check_guard_chain((char *) allocator->base, &allocator->last_guard, marker, "stack");
+#endif
+    allocator->used = marker;
 }
 
 void reset_stack_allocator( MemoryStackAllocator * allocator){
-    memset(allocator->allocations,  0, sizeof(allocator->allocations[0]) * MAX_ALLOCATION);
-    allocator->allocation_count = 0;
     allocator->used = 0;
+    allocator->last_guard = 0;
+}
+
+// @note: called once per frame, whatever is still pushed from the previous
+//        frame is released here and its high water mark is kept for display
+void begin_stack_frame(MemoryStackAllocator * allocator){
+#ifdef BREAD_MEMORY_GUARDS
+    check_guard_chain((char *) allocator->base, &allocator->last_guard, 0, "stack");
+#endif
+    allocator->last_guard = 0;
+    allocator->frame_high_water = allocator->high_water;
+    if (allocator->high_water > allocator->peak) allocator->peak = allocator->high_water;
+    allocator->used = 0;
+    allocator->high_water = 0;
 }
 
 
@@ -113,4 +539,43 @@ void reset_arena_to_zero(MemoryArena * arena){
     // question : should we reset the memory 
     //  to 0 as well for mem reset
     arena->cur = 0;
+    arena->padding = 0;
+    arena->last_guard = 0;
+}
+
+
+// Atomic bump allocator
+
+int init_atomic_arena(MemoryAtomicArena * arena, void * ptr, size_t size, unsigned int flags){
+    arena->ptr = ptr;
+    arena->size = size;
+    arena->cur = 0;
+    arena->frame_high_water = 0;
+    arena->peak = 0;
+    if (flags & MEMORY_RESERVED) return commit_memory(ptr, size, flags);
+    return 0;
+}
+
+// @note: relaxed ordering is enough, the threads that share the data are
+//        synchronised by whoever hands it out (platform_run_parallel)
+void * push_atomic(MemoryAtomicArena * arena, size_t size, size_t alignment){
+    size_t current = __atomic_load_n(&arena->cur, __ATOMIC_RELAXED);
+    for(;;){
+        size_t offset = get_alignment_offset((char *) arena->ptr + current, size, alignment);
+        size_t next = current + offset + size;
+        if (next > arena->size){
+            printf("ERROR: allocation failed, insufficient space in atomic arena\n");
+            return nullptr;
+        }
+        if (__atomic_compare_exchange_n(&arena->cur, &current, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+            count_frame_push(size);
+            return (char *) arena->ptr + current + offset;
+        }
+    }
+}
+
+void reset_atomic_arena(MemoryAtomicArena * arena){
+    arena->frame_high_water = arena->cur;
+    if (arena->cur > arena->peak) arena->peak = arena->cur;
+    arena->cur = 0;
 }
@@ -3,58 +3,235 @@
 
 #include <cstdlib>
 
-#define KB(x)  (1024 * x)
-#define MB(x)  (1024 * KB(x))
-#define GB(x)  (1024 * MB(x))
+// sizes are computed in size_t, GB(4) and up overflow an int
+#define KB(x)  ((size_t) (x) * 1024)
+#define MB(x)  (KB(x) * 1024)
+#define GB(x)  (MB(x) * 1024)
 
-#define ALLOCATE_ARRAY(arena, type, count) (type *) push_value_to_arena(arena, count * sizeof(type), alignof(type))
+#define ALLOCATE_ARRAY(arena, type, count) (type *) push_value_to_arena(arena, (count) * sizeof(type), alignof(type))
 #define ALLOCATE_STRUCT(arena, type) (type *) push_value_to_arena(arena, sizeof(type), alignof(type))
 
 #define GET_ALIGNMENT_OFFSET(pointer, type)  get_alignment_offset(pointer, sizeof(type), alignof(type))
 #define GET_ALIGNMENT_POINTER(pointer ,type) (type *) get_alignment_pointer(pointer, sizeof(type), alignof(type))
 #define RESET_ARENA(arena) reset_arena_to_zero(arena);
 
+// @note: a reserved block is only address space (mmap with PROT_NONE), the
+//        arenas and stacks placed in it commit pages as they grow into them
+//        so a large reservation costs nothing until it is used and memory
+//        never has to move. allocators without MEMORY_RESERVED treat their
+//        whole size as usable, like blocks that come from malloc
+#define MEMORY_RESERVED     (1 << 0)
+#define MEMORY_HUGE_PAGES   (1 << 1)
+#define MEMORY_PREFAULT     (1 << 2)
+
+// pages are committed in steps of at least this size to keep the number of
+// mprotect calls down, it is also the size of a huge page
+#define MEMORY_COMMIT_GRANULARITY  MB(2)
+
 struct MemoryBlock{
     void * ptr;
     size_t size;
+    unsigned int flags;
 };
 
 // General functions
 size_t get_alignment_offset(void * ptr, size_t size, size_t alignment);
 void * get_alignment_pointer(void * ptr, size_t size, size_t alignment);
 
+// Virtual memory functions
+
+// base is only a hint, the block ends up elsewhere when the range is taken
+int  reserve_memory_block(MemoryBlock * block, size_t size, unsigned int flags, void * base = nullptr);
+void release_memory_block(MemoryBlock * block);
+int  commit_memory(void * ptr, size_t size, unsigned int flags);
+
+// Snapshots
+
+// @note: copy of the first `size` bytes of a block, kept in a mapping of its
+//        own so that restoring never overwrites it. the block is copied as is
+//        and pointers into it are only valid again when it is restored at 
+//        the same address, snapshot files record that base and are refused
+//        by blocks that live anywhere else. a snapshot read from a file maps
+//        the file and only faults in the pages that are copied back
+struct MemorySnapshot {
+    void * base;
+    size_t size;
+    void * data;
+
+    // whole mapping behind data, the file header included for read snapshots
+    void * mapping;
+    size_t mapping_size;
+};
+
+int  save_memory_snapshot(MemorySnapshot * snapshot, const MemoryBlock * block, size_t size);
+int  restore_memory_snapshot(const MemorySnapshot * snapshot, MemoryBlock * block);
+void release_memory_snapshot(MemorySnapshot * snapshot);
+int  write_memory_snapshot(const MemorySnapshot * snapshot, const char * path);
+int  read_memory_snapshot(MemorySnapshot * snapshot, const char * path);
+
+// Allocation tags
+
+// @note: every push is counted against the tag that is current on the 
+//        calling thread, set through MEMORY_TAG_SCOPE. the counters are 
+//        global to the executable so they survive gamespace reloads
+#define MEMORY_TAG_UNTAGGED     0
+#define MEMORY_TAG_RENDERER     1
+#define MEMORY_TAG_WORLD        2
+#define MEMORY_TAG_PHYSICS      3
+#define MEMORY_TAG_ASSETS       4
+#define MEMORY_TAG_EDITOR       5
+#define MEMORY_TAG_COUNT        6
+
+struct MemoryTagStats {
+    // arena pushes are never given back, these only grow
+    size_t arena_bytes;
+    size_t arena_count;
+
+    // stack and atomic pushes of the running frame, the most of any frame
+    // so far and the total of the previous frame
+    size_t frame_bytes;
+    size_t frame_count;
+    size_t frame_peak;
+    size_t last_frame_bytes;
+};
+
+struct MemoryStats {
+    MemoryTagStats tags[MEMORY_TAG_COUNT];
+    // guard bands found overwritten since start
+    size_t damaged_guards;
+};
+
+unsigned int memory_set_tag(unsigned int tag);
+const char * memory_tag_name(unsigned int tag);
+const MemoryStats * memory_stats();
+void memory_stats_end_frame();
+
+struct MemoryTagScope {
+    unsigned int previous;
+
+    MemoryTagScope(unsigned int tag) : previous(memory_set_tag(tag)) {}
+    ~MemoryTagScope() { memory_set_tag(previous); }
+};
+
+#define MEMORY_TAG_SCOPE(tag) MemoryTagScope memory_tag_scope_##tag(tag)
+
+// Guard bands
+
+// @note: with BREAD_MEMORY_GUARDS every arena and stack push is followed by
+//        MEMORY_GUARD_BAND_SIZE bytes holding a known pattern and a link to
+//        the band before it, so the bands of an allocator form a chain that
+//        is walked to find overwritten ones. stack bands are checked when a 
+//        marker releases them and at the start of every frame, arena bands
+//        through check_arena_guards. atomic pushes have no bands. links are
+//        the band offset plus one so that a zeroed allocator has no chain
+#define MEMORY_GUARD_PATTERN_SIZE   16
+#define MEMORY_GUARD_BAND_SIZE      32
+
 // Arean fucntions
 struct MemoryArena{
     void * ptr;
     size_t size;
     size_t cur;
+
+    // only used for MEMORY_RESERVED arenas
+    size_t committed;
+    unsigned int flags;
+
+    // bytes lost to alignment and guard bands, and the newest guard band
+    size_t padding;
+    size_t last_guard;
 };
 
+size_t check_arena_guards(MemoryArena * arena);
+
+void init_arena(MemoryArena * arena, void * ptr, size_t size, unsigned int flags = 0);
 void * push_value_to_arena(MemoryArena * arena, size_t size, size_t alignment);
 void * pop_value_from_arena(MemoryArena *arena, size_t size, size_t alignment);
 
 
 // stack based allocation
 
-#define PUSH_IN_STACK(stack, type, count)  (type *) push_in_stack(stack, sizeof(type) * count, alignof(type))
-#define POP_FROM_STACK(stack)                       pop_from_stack(stack)
+// @note: the stack is a frame allocator, a push only bumps the used offset.
+//        memory goes back by restoring a marker taken before the pushes, 
+//        either by hand or through a MemoryStackScope, and everything is 
+//        released when the next frame begins. there is no per allocation 
+//        bookkeeping so there is no limit on the number of pushes
 
-#define MAX_ALLOCATION   128
-struct MemoryStackAllocator{
-    void * allocations[MAX_ALLOCATION];
-    unsigned int allocation_count;
+#define PUSH_IN_STACK(stack, type, count)  (type *) push_in_stack(stack, sizeof(type) * (count), alignof(type))
 
+struct MemoryStackAllocator{
     void * base;
     size_t used;
     size_t size;
+
+    // only used for MEMORY_RESERVED stacks
+    size_t committed;
+    unsigned int flags;
+
+    // highest used offset of the running frame, of the previous frame and
+    // since the allocator was initialised
+    size_t high_water;
+    size_t frame_high_water;
+    size_t peak;
+
+    size_t last_guard;
 };
 
-void init_stack_allocator(MemoryStackAllocator * allocator, void * ptr, size_t size);
+typedef size_t MemoryStackMarker;
+
+void init_stack_allocator(MemoryStackAllocator * allocator, void * ptr, size_t size, unsigned int flags = 0);
 void * push_in_stack(MemoryStackAllocator * allocator, size_t size, size_t alignment);
-void pop_from_stack(MemoryStackAllocator * allocator);
 void reset_stack_allocator( MemoryStackAllocator * allocator);
+void begin_stack_frame(MemoryStackAllocator * allocator);
+
+inline MemoryStackMarker get_stack_marker(MemoryStackAllocator * allocator){
+    return allocator->used;
+}
+
+void restore_stack_marker(MemoryStackAllocator * allocator, MemoryStackMarker marker);
+
+// releases every push made while it is alive
+struct MemoryStackScope {
+    MemoryStackAllocator * allocator;
+    MemoryStackMarker marker;
+
+    MemoryStackScope(MemoryStackAllocator * stack) : allocator(stack), marker(get_stack_marker(stack)) {}
+    ~MemoryStackScope() { restore_stack_marker(allocator, marker); }
+
+    MemoryStackScope(const MemoryStackScope &) = delete;
+    MemoryStackScope & operator=(const MemoryStackScope &) = delete;
+};
+
+#define STACK_SCOPE_CONCAT_(a, b) a##b
+#define STACK_SCOPE_CONCAT(a, b)  STACK_SCOPE_CONCAT_(a, b)
+#define STACK_SCOPE(stack) MemoryStackScope STACK_SCOPE_CONCAT(stack_scope_, __LINE__)(stack)
 
 void reset_arena_to_zero(MemoryArena * arena);
 
 
+// lock free bump allocation
+
+// @note: several threads can push into the same arena at once, a push is a 
+//        compare and swap on the offset. it is committed up front so the
+//        pushes never have to touch the pages and it is only ever reset as
+//        a whole, between frames when no thread is pushing
+
+#define PUSH_ATOMIC(arena, type, count)  (type *) push_atomic(arena, sizeof(type) * (count), alignof(type))
+
+struct MemoryAtomicArena{
+    void * ptr;
+    size_t size;
+    size_t cur;
+
+    // used size of the previous frame and the highest one seen so far
+    size_t frame_high_water;
+    size_t peak;
+};
+
+int  init_atomic_arena(MemoryAtomicArena * arena, void * ptr, size_t size, unsigned int flags = 0);
+void * push_atomic(MemoryAtomicArena * arena, size_t size, size_t alignment);
+void reset_atomic_arena(MemoryAtomicArena * arena);
+
+
+
 #endif
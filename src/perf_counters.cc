@@ -0,0 +1,227 @@
+#include "perf_counters.hh"
+
+#include <imgui.h>
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+PerfCounters g_perf = {};
+
+static const char * perf_subsystem_names[PERF_SUBSYSTEM_COUNT] = {
+    "update",
+    "physics",
+    "world",
+    "game elements",
+    "tile editor",
+};
+
+static const char * perf_counter_names[PERF_COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "l1d misses",
+    "llc misses",
+    "branch misses",
+};
+
+bool perf_counters_enabled(){
+    return g_perf.enabled;
+}
+
+#ifdef __linux__
+
+static int open_counter(unsigned int type, uint64_t config, int group_fd){
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+int perf_counters_init(){
+    const unsigned int types[PERF_COUNTER_COUNT] = {
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+    };
+    const uint64_t configs[PERF_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    memset(&g_perf, 0, sizeof(g_perf));
+    g_perf.group_size = 0;
+
+    int leader = -1;
+    for(unsigned int i = 0 ; i < PERF_COUNTER_COUNT ; i++){
+        g_perf.fds[i] = open_counter(types[i], configs[i], leader);
+        g_perf.group_index[i] = -1;
+        if (g_perf.fds[i] == -1){
+            printf("perf counters :: unable to open %s counter\n", perf_counter_names[i]);
+            if (i == PERF_COUNTER_CYCLES){
+                printf("perf counters :: disabled, check /proc/sys/kernel/perf_event_paranoid\n");
+                return -1;
+            }
+            continue;
+        }
+        if (leader == -1) leader = g_perf.fds[i];
+        g_perf.group_index[i] = g_perf.group_size;
+        g_perf.group_size += 1;
+    }
+
+    ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    g_perf.enabled = true;
+    return 0;
+}
+
+void perf_counters_shutdown(){
+    if (g_perf.enabled == false) return;
+    for(unsigned int i = 0 ; i < PERF_COUNTER_COUNT ; i++){
+        if (g_perf.fds[i] != -1) close(g_perf.fds[i]);
+    }
+    g_perf.enabled = false;
+}
+
+// @note: the group is read with one syscall, when the kernel had to multiplex
+//        the counters the values are scaled by enabled / running time
+void perf_counters_read(PerfCounterValues * values){
+    uint64_t buffer[3 + PERF_COUNTER_COUNT];
+    memset(values, 0, sizeof(PerfCounterValues));
+    if (read(g_perf.fds[PERF_COUNTER_CYCLES], buffer, sizeof(buffer)) <= 0) return;
+
+    uint64_t time_enabled = buffer[1];
+    uint64_t time_running = buffer[2];
+    double scale = time_running ? (double) time_enabled / (double) time_running : 1.0;
+
+    for(unsigned int i = 0 ; i < PERF_COUNTER_COUNT ; i++){
+        if (g_perf.group_index[i] == -1) continue;
+        values->values[i] = (uint64_t) (buffer[3 + g_perf.group_index[i]] * scale);
+    }
+}
+
+#else
+
+int perf_counters_init(){
+    printf("perf counters :: only supported on linux\n");
+    return -1;
+}
+
+void perf_counters_shutdown(){}
+
+void perf_counters_read(PerfCounterValues * values){
+    memset(values, 0, sizeof(PerfCounterValues));
+}
+
+#endif
+
+void perf_counters_accumulate(unsigned int subsystem, const PerfCounterValues * begin){
+    PerfCounterValues end;
+    perf_counters_read(&end);
+    for(unsigned int i = 0 ; i < PERF_COUNTER_COUNT ; i++){
+        g_perf.frame[subsystem][i] += end.values[i] - begin->values[i];
+    }
+}
+
+void perf_counters_frame_end(){
+    if (g_perf.enabled == false) return;
+    memcpy(g_perf.history[g_perf.frame_count % PERF_COUNTER_HISTORY], g_perf.frame, sizeof(g_perf.frame));
+    memset(g_perf.frame, 0, sizeof(g_perf.frame));
+    g_perf.frame_count += 1;
+}
+
+int perf_counters_dump_csv(const char * filepath){
+    FILE * file = fopen(filepath, "w");
+    if (file == nullptr){
+        printf("perf counters :: unable to open %s\n", filepath);
+        return -1;
+    }
+
+    fprintf(file, "frame,subsystem,cycles,instructions,l1d_misses,llc_misses,branch_misses,ipc\n");
+    uint64_t available = g_perf.frame_count < PERF_COUNTER_HISTORY ? g_perf.frame_count : PERF_COUNTER_HISTORY;
+    for(uint64_t frame = g_perf.frame_count - available ; frame < g_perf.frame_count ; frame++){
+        for(unsigned int s = 0 ; s < PERF_SUBSYSTEM_COUNT ; s++){
+            uint64_t * counters = g_perf.history[frame % PERF_COUNTER_HISTORY][s];
+            double ipc = counters[PERF_COUNTER_CYCLES] ? (double) counters[PERF_COUNTER_INSTRUCTIONS] / counters[PERF_COUNTER_CYCLES] : 0.0;
+            fprintf(file, "%lu,%s,%lu,%lu,%lu,%lu,%lu,%.3f\n",
+                    (unsigned long) frame, perf_subsystem_names[s],
+                    (unsigned long) counters[PERF_COUNTER_CYCLES],
+                    (unsigned long) counters[PERF_COUNTER_INSTRUCTIONS],
+                    (unsigned long) counters[PERF_COUNTER_L1D_MISSES],
+                    (unsigned long) counters[PERF_COUNTER_LLC_MISSES],
+                    (unsigned long) counters[PERF_COUNTER_BRANCH_MISSES],
+                    ipc);
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+void perf_counters_draw_panel(){
+    ImGui::Begin("Perf counters");
+    if (g_perf.enabled == false){
+        ImGui::Text("disabled, start with --perf-counters");
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::Button("dump csv")){
+        if (perf_counters_dump_csv("perf_counters.csv") == 0){
+            printf("perf counters :: written to perf_counters.csv\n");
+        }
+    }
+
+    // averages over the frames in the history
+    uint64_t available = g_perf.frame_count < PERF_COUNTER_HISTORY ? g_perf.frame_count : PERF_COUNTER_HISTORY;
+    if (available == 0){
+        ImGui::End();
+        return;
+    }
+
+    if (ImGui::BeginTable("perf counter table", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)){
+        ImGui::TableSetupColumn("subsystem");
+        ImGui::TableSetupColumn("cycles / frame");
+        ImGui::TableSetupColumn("ipc");
+        ImGui::TableSetupColumn("l1d miss / kinstr");
+        ImGui::TableSetupColumn("llc miss / kinstr");
+        ImGui::TableSetupColumn("branch miss / kinstr");
+        ImGui::TableHeadersRow();
+
+        for(unsigned int s = 0 ; s < PERF_SUBSYSTEM_COUNT ; s++){
+            double totals[PERF_COUNTER_COUNT] = {};
+            for(uint64_t frame = g_perf.frame_count - available ; frame < g_perf.frame_count ; frame++){
+                for(unsigned int c = 0 ; c < PERF_COUNTER_COUNT ; c++){
+                    totals[c] += (double) g_perf.history[frame % PERF_COUNTER_HISTORY][s][c];
+                }
+            }
+            double kilo_instructions = totals[PERF_COUNTER_INSTRUCTIONS] / 1000.0;
+            double per_kilo = kilo_instructions > 0.0 ? 1.0 / kilo_instructions : 0.0;
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn(); ImGui::Text("%s", perf_subsystem_names[s]);
+            ImGui::TableNextColumn(); ImGui::Text("%.0f", totals[PERF_COUNTER_CYCLES] / available);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", totals[PERF_COUNTER_CYCLES] > 0.0 ? totals[PERF_COUNTER_INSTRUCTIONS] / totals[PERF_COUNTER_CYCLES] : 0.0);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", totals[PERF_COUNTER_L1D_MISSES] * per_kilo);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", totals[PERF_COUNTER_LLC_MISSES] * per_kilo);
+            ImGui::TableNextColumn(); ImGui::Text("%.2f", totals[PERF_COUNTER_BRANCH_MISSES] * per_kilo);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
@@ -0,0 +1,68 @@
+#ifndef PERF_COUNTERS_HH
+#define PERF_COUNTERS_HH
+
+#include <cstdint>
+
+// Hardware performance counters per engine subsystem (linux only). the 
+// counters are opened with perf_event_open as one group on the main thread
+// and read with a single read() around every subsystem scope. counting is 
+// off unless perf_counters_init was called (the --perf-counters flag), and
+// work handed to the worker threads is not attributed to the subsystem
+
+#define PERF_SUBSYSTEM_UPDATE           0
+#define PERF_SUBSYSTEM_PHYSICS          1
+#define PERF_SUBSYSTEM_WORLD            2
+#define PERF_SUBSYSTEM_GAME_ELEMENTS    3
+#define PERF_SUBSYSTEM_TILE_EDITOR      4
+#define PERF_SUBSYSTEM_COUNT            5
+
+#define PERF_COUNTER_CYCLES             0
+#define PERF_COUNTER_INSTRUCTIONS       1
+#define PERF_COUNTER_L1D_MISSES         2
+#define PERF_COUNTER_LLC_MISSES         3
+#define PERF_COUNTER_BRANCH_MISSES      4
+#define PERF_COUNTER_COUNT              5
+
+#define PERF_COUNTER_HISTORY            256
+
+struct PerfCounters {
+    bool enabled;
+
+    int fds[PERF_COUNTER_COUNT];
+    // position of every counter in the group read, -1 when it failed to open
+    int group_index[PERF_COUNTER_COUNT];
+    unsigned int group_size;
+
+    uint64_t frame[PERF_SUBSYSTEM_COUNT][PERF_COUNTER_COUNT];
+    uint64_t history[PERF_COUNTER_HISTORY][PERF_SUBSYSTEM_COUNT][PERF_COUNTER_COUNT];
+    uint64_t frame_count;
+};
+
+struct PerfCounterValues {
+    uint64_t values[PERF_COUNTER_COUNT];
+};
+
+int  perf_counters_init();
+void perf_counters_shutdown();
+bool perf_counters_enabled();
+void perf_counters_read(PerfCounterValues * values);
+void perf_counters_accumulate(unsigned int subsystem, const PerfCounterValues * begin);
+void perf_counters_frame_end();
+int  perf_counters_dump_csv(const char * filepath);
+void perf_counters_draw_panel();
+
+struct PerfCounterScope {
+    unsigned int subsystem;
+    PerfCounterValues begin;
+
+    PerfCounterScope(unsigned int id) : subsystem(id) {
+        if (perf_counters_enabled()) perf_counters_read(&begin);
+    }
+    ~PerfCounterScope() {
+        if (perf_counters_enabled()) perf_counters_accumulate(subsystem, &begin);
+    }
+};
+
+#define PERF_COUNTER_SCOPE(subsystem) PerfCounterScope perf_counter_scope_##subsystem(subsystem)
+
+#endif
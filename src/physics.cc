@@ -5,52 +5,63 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <vector>
-#include <unordered_set>
+#include <cstdio>
+
+#include "containers.hh"
+
+// at most four vertices per box, no memory is needed for them
+typedef SmallVector<glm::vec2, 4> Polygon;
 
 struct HashGlmVec2 {
-    size_t operator () (const glm::vec2 & a) const {
+    uint64_t operator () (const glm::vec2 & a) const {
         unsigned int xhashint = *((unsigned int *)(&a.x));
         unsigned int yhashint = *((unsigned int *)(&a.y));
         return  (xhashint) ^ (yhashint << 1);
     }
 };
 
-struct EqualGlmVec2 {
-    bool operator() (const glm::vec2 & a, const glm::vec2 & b) const {
-        return a == b;
+// the set of axes is allocated from scratch and released on return
+bool check_collision_separating_axis_theorem(const Polygon * polygon_a, const Polygon * polygon_b, MemoryStackAllocator * scratch){
+    STACK_SCOPE(scratch);
+    HashMap<glm::vec2, bool, HashGlmVec2> axises;
+    if (init_hash_map(&axises, container_allocator(scratch), polygon_a->count + polygon_b->count)){
+        printf("check_collision_separating_axis_theorem : out of scratch memory\n");
+        return false;
     }
-};
 
-bool check_collision_separating_axis_theorem(const std::vector<glm::vec2> & a, const std::vector<glm::vec2> & b){
-    std::unordered_set<glm::vec2, HashGlmVec2, EqualGlmVec2> axises;
+    const glm::vec2 * a = small_vector_items(polygon_a);
+    const glm::vec2 * b = small_vector_items(polygon_b);
 
-    for(unsigned int i = 0; i < a.size(); i++){
-        const glm::vec2 along = glm::normalize((a[i] - a[(i + 1) % a.size()]));
-        axises.insert(glm::vec2(along.y, -along.x));
+    for(unsigned int i = 0; i < polygon_a->count; i++){
+        const glm::vec2 along = glm::normalize((a[i] - a[(i + 1) % polygon_a->count]));
+        hash_map_put(&axises, glm::vec2(along.y, -along.x), true);
     }
 
-    for(unsigned int i = 0; i < b.size(); i++){
-        const glm::vec2 along = glm::normalize((b[i] - b[(i + 1) % b.size()]));
-        axises.insert(glm::vec2(along.y, -along.x));
+    for(unsigned int i = 0; i < polygon_b->count; i++){
+        const glm::vec2 along = glm::normalize((b[i] - b[(i + 1) % polygon_b->count]));
+        hash_map_put(&axises, glm::vec2(along.y, -along.x), true);
     }
 
 
     float minimum_overlap = 10e10;
     glm::vec2 minimum_seperation_axis = glm::vec2(0.0);
 
-    for(const glm::vec2 axis : axises){
+    for(unsigned int slot = 0; slot < axises.capacity; slot++){
+        if (axises.used[slot] == 0) continue;
+        const glm::vec2 axis = axises.keys[slot];
 
         float amin = 10e10;
         float amax = -10e10;
         float bmin = 10e10;
         float bmax = -10e10;
-        for(const glm::vec2 point: a){
+        for(unsigned int i = 0; i < polygon_a->count; i++){
+            const glm::vec2 point = a[i];
             float dot = glm::dot(axis, point);
             amin = amin > dot ? dot : amin;
             amax = dot > amax ? dot : amax;
         }
-        for(const glm::vec2 point: b){
+        for(unsigned int i = 0; i < polygon_b->count; i++){
+            const glm::vec2 point = b[i];
             float dot = glm::dot(axis, point);
             bmin = bmin > dot ? dot : bmin;
             bmax = dot > bmax ? dot : bmax;
@@ -65,17 +76,21 @@ bool check_collision_separating_axis_theorem(const std::vector<glm::vec2> & a, c
 
     }
 
-    for(const glm::vec2 axis: axises){
+    for(unsigned int slot = 0; slot < axises.capacity; slot++){
+        if (axises.used[slot] == 0) continue;
+        const glm::vec2 axis = axises.keys[slot];
         float amin = 10e10;
         float amax = -10e10;
         float bmin = 10e10;
         float bmax = -10e10;
-        for(const glm::vec2 point: a){
+        for(unsigned int i = 0; i < polygon_a->count; i++){
+            const glm::vec2 point = a[i];
             float dot = glm::dot(axis, point);
             amin = amin > dot ? dot : amin;
             amax = dot > amax ? dot : amax;
         }
-        for(const glm::vec2 point: b){
+        for(unsigned int i = 0; i < polygon_b->count; i++){
+            const glm::vec2 point = b[i];
             float dot = glm::dot(axis, point);
             bmin = bmin > dot ? dot : bmin;
             bmax = dot > bmax ? dot : bmax;
@@ -87,11 +102,16 @@ bool check_collision_separating_axis_theorem(const std::vector<glm::vec2> & a, c
 
 // @note: this is an expensive function which performs a sa
 
-bool check_collision_via_sat(BoxCollider * a, BoxCollider * b){
+bool check_collision_via_sat(BoxCollider * a, BoxCollider * b, MemoryStackAllocator * scratch){
 
-    // @notes: this is a heap allocation
-    std::vector<glm::vec2> apoints(4);
-    std::vector<glm::vec2> bpoints(4);
+    Polygon polygon_a;
+    Polygon polygon_b;
+    init_small_vector(&polygon_a);
+    init_small_vector(&polygon_b);
+    polygon_a.count = 4;
+    polygon_b.count = 4;
+    glm::vec2 * apoints = small_vector_items(&polygon_a);
+    glm::vec2 * bpoints = small_vector_items(&polygon_b);
 
     {
         apoints[0] = glm::vec2(a->pos.x - a->dim.x * 0.5, a->pos.y - a->dim.y * 0.5);
@@ -118,7 +138,7 @@ bool check_collision_via_sat(BoxCollider * a, BoxCollider * b){
 
     }
 
-    bool result = check_collision_separating_axis_theorem(apoints, bpoints);
+    bool result = check_collision_separating_axis_theorem(&polygon_a, &polygon_b, scratch);
 
     return result;
 }
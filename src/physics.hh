@@ -2,6 +2,8 @@
 #define PHYSICS_HH
 
 #include <glm/glm.hpp>
+
+#include "memory.hh"
  
 #define NONE    0
 #define GRAVITY 1
@@ -19,7 +21,8 @@ struct BoxCollider{
 };
 
 
-bool check_collision_via_sat(BoxCollider * b1, BoxCollider * b2);
+// scratch holds the temporaries of the test, nothing stays pushed on it
+bool check_collision_via_sat(BoxCollider * b1, BoxCollider * b2, MemoryStackAllocator * scratch);
 
 
 #endif
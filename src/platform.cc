@@ -1,4 +1,7 @@
 #include "platform.hh"
+#include "gpu_profiler.hh"
+#include "profiler.hh"
+#include "texture_cache.hh"
 
 #include <SDL2/SDL.h>
 
@@ -6,9 +9,30 @@
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
 
+#include <stb_image.h>
+
 #include <string>
+#include <cstring>
+
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 SystemStateHandler g_state = {0};
+PlatformWorkerPool g_workers = {0};
+PlatformImageLoader g_images = {0};
+PlatformFileWatcher g_watcher = {0};
+PlatformRenderThread g_render = {0};
+PlatformInputRecorder g_input = {0};
+
+// ImGui draw data is only valid until the next ImGui::NewFrame, so each
+// command frame carries its own copy of the draw lists
+ImDrawData g_imgui_frames[2];
+
+// 0 for the main thread, 1 .. thread_count for the workers
+static thread_local unsigned int t_thread_index = 0;
 
 const SDL_Window * get_window_handle(){
     return g_state.window_handle;
@@ -95,6 +119,290 @@ unsigned int get_ticks_since_start(){
     return g_state.ticks;
 }
 
+bool is_live_key_pressed(int keycode){
+    keycode = get_key_offset(keycode);
+    return g_input.live_key.cur[keycode] == true && g_input.live_key.pre[keycode] == false;
+}
+
+unsigned int platform_worker_count(){
+    return g_workers.thread_count;
+}
+
+unsigned int platform_thread_index(){
+    return t_thread_index;
+}
+
+static void run_available_jobs(){
+    for(;;){
+        int job = SDL_AtomicAdd(&g_workers.next_job, 1);
+        if (job >= (int) g_workers.job_count) break;
+        PROFILE_SCOPE("parallel job");
+        g_workers.function(g_workers.data, (unsigned int) job);
+    }
+}
+
+static int worker_thread_main(void * param){
+    t_thread_index = (unsigned int) (size_t) param;
+
+    char name[32];
+    snprintf(name, sizeof(name), "worker %u", t_thread_index);
+    profiler_set_thread_name(name);
+
+    for(;;){
+        SDL_SemWait(g_workers.work_available);
+        if (SDL_AtomicGet(&g_workers.quit)) break;
+        run_available_jobs();
+        SDL_SemPost(g_workers.work_finished);
+    }
+    return 0;
+}
+
+void platform_run_parallel(platform_job_function_t function, void * data, unsigned int job_count){
+    if (job_count == 0) return;
+
+    if (g_workers.thread_count == 0 || job_count == 1){
+        for(unsigned int i = 0 ; i < job_count ; i++) function(data, i);
+        return;
+    }
+
+    g_workers.function = function;
+    g_workers.data = data;
+    g_workers.job_count = job_count;
+    SDL_AtomicSet(&g_workers.next_job, 0);
+
+    // the calling thread takes part as well so one job less is enough to wake
+    unsigned int wake_count = job_count - 1 < g_workers.thread_count ? job_count - 1 : g_workers.thread_count;
+    for(unsigned int i = 0 ; i < wake_count ; i++) SDL_SemPost(g_workers.work_available);
+
+    run_available_jobs();
+
+    for(unsigned int i = 0 ; i < wake_count ; i++) SDL_SemWait(g_workers.work_finished);
+}
+
+static void platform_init_workers(){
+    int cpu_count = SDL_GetCPUCount();
+    unsigned int thread_count = cpu_count > 1 ? cpu_count - 1 : 0;
+    if (thread_count > MAX_WORKER_THREADS) thread_count = MAX_WORKER_THREADS;
+
+    g_workers.work_available = SDL_CreateSemaphore(0);
+    g_workers.work_finished  = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&g_workers.quit, 0);
+
+    g_workers.thread_count = 0;
+    for(unsigned int i = 0 ; i < thread_count ; i++){
+        SDL_Thread * thread = SDL_CreateThread(worker_thread_main, "worker", (void *) (size_t) (i + 1));
+        if (thread == nullptr){
+            printf("unable to create worker thread : %s\n", SDL_GetError());
+            break;
+        }
+        g_workers.threads[g_workers.thread_count] = thread;
+        g_workers.thread_count += 1;
+    }
+    printf("platform :: %u worker threads\n", g_workers.thread_count);
+}
+
+static void platform_shutdown_workers(){
+    SDL_AtomicSet(&g_workers.quit, 1);
+    for(unsigned int i = 0 ; i < g_workers.thread_count ; i++) SDL_SemPost(g_workers.work_available);
+    for(unsigned int i = 0 ; i < g_workers.thread_count ; i++) SDL_WaitThread(g_workers.threads[i], nullptr);
+    g_workers.thread_count = 0;
+
+    SDL_DestroySemaphore(g_workers.work_available);
+    SDL_DestroySemaphore(g_workers.work_finished);
+}
+
+// the cooked copy from the texture cache is mapped as is, only a missing or
+// stale one goes through the png decoder (and is cooked for the next run)
+static void decode_image_request(PlatformImageRequest * request){
+    PROFILE_SCOPE("decode image");
+    if (texture_cache_load(request->filepath, &request->cooked) == 0){
+        request->pixels = texture_cache_mip(&request->cooked, 0, &request->width, &request->height);
+        SDL_AtomicSet(&request->state, IMAGE_REQUEST_DECODED);
+        return;
+    }
+
+    int width, height, component;
+    request->pixels = stbi_load(request->filepath, &width, &height, &component, 4);
+    if (request->pixels == nullptr){
+        printf("image loader :: failed to decode %s : %s\n", request->filepath, stbi_failure_reason());
+        SDL_AtomicSet(&request->state, IMAGE_REQUEST_FAILED);
+        return;
+    }
+    request->width = width;
+    request->height = height;
+    SDL_AtomicSet(&request->state, IMAGE_REQUEST_DECODED);
+}
+
+static void free_image_request(PlatformImageRequest * request){
+    if (request->cooked.mapping) texture_cache_unload(&request->cooked);
+    else if (request->pixels) stbi_image_free((void *) request->pixels);
+    request->pixels = nullptr;
+}
+
+static int image_loader_main(void * param){
+    profiler_set_thread_name("image loader");
+
+    for(;;){
+        SDL_SemWait(g_images.requests_available);
+        if (SDL_AtomicGet(&g_images.quit)) break;
+
+        // every post belongs to one pending request, claim any of them
+        for(unsigned int i = 0 ; i < MAX_IMAGE_REQUESTS ; i++){
+            PlatformImageRequest * request = g_images.requests + i;
+            if (SDL_AtomicCAS(&request->state, IMAGE_REQUEST_PENDING, IMAGE_REQUEST_DECODING) == SDL_FALSE) continue;
+
+            decode_image_request(request);
+            break;
+        }
+    }
+    return 0;
+}
+
+int platform_request_image(const char * filepath){
+    if (strlen(filepath) >= sizeof(g_images.requests[0].filepath)){
+        printf("image loader :: path too long %s\n", filepath);
+        return -1;
+    }
+
+    for(unsigned int i = 0 ; i < MAX_IMAGE_REQUESTS ; i++){
+        PlatformImageRequest * request = g_images.requests + i;
+        if (SDL_AtomicGet(&request->state) != IMAGE_REQUEST_FREE) continue;
+
+        strcpy(request->filepath, filepath);
+        request->pixels = nullptr;
+        request->cooked = {};
+        request->width = 0;
+        request->height = 0;
+        SDL_AtomicSet(&request->state, IMAGE_REQUEST_PENDING);
+
+        // without loader threads the request is decoded on the first poll
+        if (g_images.thread_count) SDL_SemPost(g_images.requests_available);
+        return i;
+    }
+    printf("image loader :: out of request slots\n");
+    return -1;
+}
+
+int platform_poll_image(int id, const unsigned char ** pixels, unsigned int * width, unsigned int * height){
+    if (id < 0 || id >= MAX_IMAGE_REQUESTS) return IMAGE_REQUEST_FAILED;
+    PlatformImageRequest * request = g_images.requests + id;
+
+    if (g_images.thread_count == 0 && SDL_AtomicGet(&request->state) == IMAGE_REQUEST_PENDING){
+        decode_image_request(request);
+    }
+
+    int state = SDL_AtomicGet(&request->state);
+    if (state == IMAGE_REQUEST_DECODED){
+        *pixels = request->pixels;
+        *width = request->width;
+        *height = request->height;
+    }
+    return state;
+}
+
+void platform_release_image(int id){
+    if (id < 0 || id >= MAX_IMAGE_REQUESTS) return;
+    PlatformImageRequest * request = g_images.requests + id;
+
+    int state = SDL_AtomicGet(&request->state);
+    if (state != IMAGE_REQUEST_DECODED && state != IMAGE_REQUEST_FAILED) return;
+    free_image_request(request);
+    SDL_AtomicSet(&request->state, IMAGE_REQUEST_FREE);
+}
+
+static void platform_init_image_loader(){
+    // every image of the game is stored bottom row first for GL
+    stbi_set_flip_vertically_on_load(true);
+
+    g_images.requests_available = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&g_images.quit, 0);
+
+    g_images.thread_count = 0;
+    for(unsigned int i = 0 ; i < IMAGE_LOADER_THREADS ; i++){
+        SDL_Thread * thread = SDL_CreateThread(image_loader_main, "image loader", nullptr);
+        if (thread == nullptr){
+            printf("unable to create image loader thread : %s\n", SDL_GetError());
+            break;
+        }
+        g_images.threads[g_images.thread_count] = thread;
+        g_images.thread_count += 1;
+    }
+}
+
+static void platform_shutdown_image_loader(){
+    SDL_AtomicSet(&g_images.quit, 1);
+    for(unsigned int i = 0 ; i < g_images.thread_count ; i++) SDL_SemPost(g_images.requests_available);
+    for(unsigned int i = 0 ; i < g_images.thread_count ; i++) SDL_WaitThread(g_images.threads[i], nullptr);
+    g_images.thread_count = 0;
+
+    for(unsigned int i = 0 ; i < MAX_IMAGE_REQUESTS ; i++){
+        free_image_request(g_images.requests + i);
+        SDL_AtomicSet(&g_images.requests[i].state, IMAGE_REQUEST_FREE);
+    }
+    SDL_DestroySemaphore(g_images.requests_available);
+}
+
+int platform_watch_directory(const char * path){
+    if (g_watcher.fd == -1) return -1;
+    if (g_watcher.watch_count == MAX_WATCHED_DIRECTORIES || strlen(path) >= MAX_WATCH_PATH){
+        printf("file watcher :: unable to watch %s\n", path);
+        return -1;
+    }
+
+    int watch = inotify_add_watch(g_watcher.fd, path, IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch == -1){
+        printf("file watcher :: unable to watch %s\n", path);
+        return -1;
+    }
+    g_watcher.watches[g_watcher.watch_count] = watch;
+    strcpy(g_watcher.directories[g_watcher.watch_count], path);
+    g_watcher.watch_count += 1;
+    return 0;
+}
+
+unsigned int platform_changed_file_count(){
+    return g_watcher.changed_count;
+}
+
+const char * platform_changed_file(unsigned int index){
+    return index < g_watcher.changed_count ? g_watcher.changed[index] : nullptr;
+}
+
+static void platform_update_file_watcher(){
+    g_watcher.changed_count = 0;
+    if (g_watcher.fd == -1) return;
+
+    alignas(inotify_event) char buffer[4096];
+    for(;;){
+        ssize_t length = read(g_watcher.fd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+
+        for(char * cursor = buffer ; cursor < buffer + length ; ){
+            inotify_event * event = (inotify_event *) cursor;
+            cursor += sizeof(inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            const char * directory = nullptr;
+            for(unsigned int i = 0 ; i < g_watcher.watch_count ; i++){
+                if (g_watcher.watches[i] == event->wd) directory = g_watcher.directories[i];
+            }
+            if (directory == nullptr) continue;
+
+            char path[MAX_WATCH_PATH];
+            snprintf(path, sizeof(path), "%s/%s", directory, event->name);
+
+            // a save usually shows up as several events for the same file
+            bool listed = false;
+            for(unsigned int i = 0 ; i < g_watcher.changed_count && listed == false ; i++){
+                listed = strcmp(g_watcher.changed[i], path) == 0;
+            }
+            if (listed || g_watcher.changed_count == MAX_CHANGED_FILES) continue;
+            strcpy(g_watcher.changed[g_watcher.changed_count], path);
+            g_watcher.changed_count += 1;
+        }
+    }
+}
+
 void opengl_debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam){
     // Ignore non-significant error/warning codes
     if (id == 131169 || id == 131185 || id == 131218 || id == 131204) return;
@@ -165,11 +473,224 @@ void platform_init(const char * window, unsigned int width, unsigned int height,
     ImGui::StyleColorsDark();
     ImGui_ImplSDL2_InitForOpenGL(windowHandle, contextHandle);
     ImGui_ImplOpenGL3_Init(shader_preprocessor);
+    // the font atlas and the backend objects are built here, on the main 
+    // thread, while it still owns the context. ImGui::NewFrame needs the
+    // atlas on the first frame, and the render thread must never touch
+    // io.Fonts while the main thread is building widgets
+    unsigned char * font_pixels = nullptr;
+    int font_width = 0, font_height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&font_pixels, &font_width, &font_height);
+    ImGui_ImplOpenGL3_CreateDeviceObjects();
+    gpu_profiler_init();
+
+    platform_init_workers();
+    platform_init_image_loader();
+
+    g_watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_watcher.fd == -1) printf("file watcher :: inotify unavailable\n");
+}
+
+void platform_init_headless(unsigned int width, unsigned int height, unsigned int frame_ms){
+    // only for the threads, semaphores and the performance counter
+    SDL_Init(SDL_INIT_TIMER);
+    g_state.headless = true;
+    g_state.headless_frame_ms = frame_ms;
+    g_state.window_width = width;
+    g_state.window_height = height;
+    g_state.ticks = 0;
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO & io = ImGui::GetIO();
+    ImGui::StyleColorsDark();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2((float) width, (float) height);
+    // NewFrame needs the font atlas even though it is never uploaded
+    unsigned char * font_pixels = nullptr;
+    int font_width = 0, font_height = 0;
+    io.Fonts->GetTexDataAsRGBA32(&font_pixels, &font_width, &font_height);
+
+    platform_init_workers();
+    platform_init_image_loader();
+
+    g_watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_watcher.fd == -1) printf("file watcher :: inotify unavailable\n");
+}
+
+bool platform_is_headless(){
+    return g_state.headless;
+}
+
+
+
+
+///////////// INPUT RECORDING ///////////////////////////////////////////
+
+#define INPUT_FILE_MAGIC    0x54504e49  // "INPT"
+#define INPUT_FILE_VERSION  1
+
+struct InputFileHeader {
+    unsigned int magic;
+    unsigned int version;
+    // files recorded by a build with a different layout are refused
+    unsigned int frame_size;
+    unsigned int key_count;
+};
+
+// quitting is left to the person watching the playback
+#define INPUT_RECORDED_STATE  (~(STATE_QUIT_REQUESTED))
+
+static void encode_input_frame(InputFrame * frame){
+    *frame = {};
+    for(int i = 0 ; i < KEYCOUNT ; i++){
+        if (g_state.key.cur[i]) frame->keys[i / 8] |= 1 << (i % 8);
+    }
+    for(int i = 0 ; i < BUTTONCOUNT ; i++){
+        if (g_state.mouse.cur[i]) frame->buttons |= 1 << i;
+    }
+    frame->central_state = g_state.central_state & INPUT_RECORDED_STATE;
+    frame->xpos = g_state.mouse.xpos;
+    frame->ypos = g_state.mouse.ypos;
+    frame->xrel = g_state.mouse.xrel;
+    frame->yrel = g_state.mouse.yrel;
+    frame->ticks = g_state.ticks;
+}
+
+static void decode_input_buttons(const InputFrame * frame, bool * keys, char * buttons){
+    for(int i = 0 ; i < KEYCOUNT ; i++){
+        keys[i] = frame && (frame->keys[i / 8] & (1 << (i % 8)));
+    }
+    for(int i = 0 ; i < BUTTONCOUNT ; i++){
+        buttons[i] = frame && (frame->buttons & (1 << i));
+    }
 }
 
+static void decode_input_frame(const InputFrame * frame){
+    decode_input_buttons(frame, g_state.key.cur, g_state.mouse.cur);
+    g_state.central_state = (g_state.central_state & ~INPUT_RECORDED_STATE) | (frame->central_state & INPUT_RECORDED_STATE);
+    g_state.mouse.xpos = frame->xpos;
+    g_state.mouse.ypos = frame->ypos;
+    g_state.mouse.xrel = frame->xrel;
+    g_state.mouse.yrel = frame->yrel;
+    g_state.ticks = frame->ticks;
+}
 
+int platform_begin_input_recording(const char * path){
+    platform_end_input();
+    FILE * file = fopen(path, "wb");
+    if (file == nullptr){
+        printf("input :: unable to open %s for recording\n", path);
+        return -1;
+    }
+    InputFileHeader header = { INPUT_FILE_MAGIC, INPUT_FILE_VERSION, sizeof(InputFrame), KEYCOUNT };
+    fwrite(&header, sizeof(header), 1, file);
+
+    g_input.file = file;
+    g_input.next_frame = 0;
+    g_input.mode = INPUT_RECORDING;
+    return 0;
+}
+
+int platform_begin_input_playback(const char * path){
+    platform_end_input();
+    int fd = open(path, O_RDONLY);
+    if (fd == -1){
+        printf("input :: unable to open %s for playback\n", path);
+        return -1;
+    }
+    struct stat info;
+    if (fstat(fd, &info) || (size_t) info.st_size < sizeof(InputFileHeader) + sizeof(InputFrame)){
+        printf("input :: %s holds no recorded frames\n", path);
+        close(fd);
+        return -1;
+    }
+    void * mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED){
+        printf("input :: unable to map %s\n", path);
+        return -1;
+    }
+
+    const InputFileHeader * header = (const InputFileHeader *) mapping;
+    if (header->magic != INPUT_FILE_MAGIC || header->version != INPUT_FILE_VERSION || 
+            header->frame_size != sizeof(InputFrame) || header->key_count != KEYCOUNT){
+        printf("input :: %s was not recorded by this build\n", path);
+        munmap(mapping, info.st_size);
+        return -1;
+    }
+
+    g_input.mapping = mapping;
+    g_input.mapping_size = info.st_size;
+    g_input.frames = (const InputFrame *) ((char *) mapping + sizeof(InputFileHeader));
+    g_input.frame_count = (info.st_size - sizeof(InputFileHeader)) / sizeof(InputFrame);
+    g_input.mode = INPUT_PLAYBACK;
+    platform_seek_input(0);
+    return 0;
+}
+
+void platform_end_input(){
+    if (g_input.file){
+        fclose(g_input.file);
+        printf("input :: recorded %u frames\n", g_input.next_frame);
+    }
+    if (g_input.mapping){
+        munmap(g_input.mapping, g_input.mapping_size);
+        g_state.key = g_input.live_key;
+    }
+
+    KeyboardState live_key = g_input.live_key;
+    g_input = {};
+    g_input.live_key = live_key;
+}
+
+int platform_input_mode(){
+    return g_input.mode;
+}
+
+unsigned int platform_input_frame(){
+    return g_input.next_frame;
+}
+
+unsigned int platform_input_frame_count(){
+    return g_input.mode == INPUT_PLAYBACK ? g_input.frame_count : g_input.next_frame;
+}
+
+void platform_seek_input(unsigned int frame){
+    if (g_input.mode != INPUT_PLAYBACK) return;
+    if (frame >= g_input.frame_count) frame = 0;
+    g_input.next_frame = frame;
+}
+
+// runs after the SDL events of the frame are in g_state, which holds the
+// live keyboard at that point also during playback
+static void platform_update_input_recorder(){
+    g_input.live_key = g_state.key;
+
+    if (g_input.mode == INPUT_RECORDING){
+        InputFrame frame;
+        encode_input_frame(&frame);
+        if (fwrite(&frame, sizeof(frame), 1, g_input.file) != 1){
+            printf("input :: unable to write the recording, stopping\n");
+            platform_end_input();
+            return;
+        }
+        g_input.next_frame += 1;
+    }
+
+    // the previous state of keys and buttons comes from the frame before, so
+    // a seek does not show up as presses or releases
+    if (g_input.mode == INPUT_PLAYBACK){
+        if (g_input.next_frame >= g_input.frame_count) platform_seek_input(0);
+        unsigned int frame = g_input.next_frame;
+        decode_input_buttons(frame ? g_input.frames + frame - 1 : nullptr, g_state.key.pre, g_state.mouse.pre);
+        decode_input_frame(g_input.frames + frame);
+        g_input.next_frame += 1;
+    }
+}
 
 void platform_update_input_state(){
+    PROFILE_FUNCTION();
+    platform_update_file_watcher();
     
     
     // resettign the central event state variable
@@ -179,6 +700,10 @@ void platform_update_input_state(){
     g_state.central_state &= ~ (STATE_MOUSE_BUTTON_EVENT);
     g_state.central_state &= ~ (STATE_MOUSE_MOTION_EVENT);
 
+    // the keyboard events of the frame go to the live state, the recorded
+    // one is put over it afterwards
+    if (g_input.mode == INPUT_PLAYBACK) g_state.key = g_input.live_key;
+
     // reset keyboard and mouse
     for(int i = 0 ; i < KEYCOUNT ; i++){
         g_state.key.pre[i] = g_state.key.cur[i];
@@ -198,7 +723,7 @@ void platform_update_input_state(){
     ImGuiIO io = ImGui::GetIO();
 
     SDL_Event sdl_event;
-    while(SDL_PollEvent(&sdl_event)){
+    while(g_state.headless == false && SDL_PollEvent(&sdl_event)){
         ImGui_ImplSDL2_ProcessEvent(&sdl_event);
 
         // if ImGUI wants to capture this particular event then we don't pass this event to 
@@ -256,23 +781,157 @@ void platform_update_input_state(){
                 break;
         }
     }
-    g_state.ticks = SDL_GetTicks();
+    // the headless clock is simulated so a run does not depend on its speed
+    if (g_state.headless && g_state.headless_frame_ms) g_state.ticks += g_state.headless_frame_ms;
+    else g_state.ticks = SDL_GetTicks();
+    platform_update_input_recorder();
 }
 
-void platform_begin_rendering(){
+static void copy_imgui_draw_data(ImDrawData * target, ImDrawData * source){
+    for(int i = 0 ; i < target->CmdListsCount ; i++){
+        IM_DELETE(target->CmdLists[i]);
+    }
+    target->CmdLists.clear();
+    target->CmdListsCount = 0;
+    target->Valid = false;
+    if (source == nullptr || source->Valid == false) return;
+
+    *target = *source;
+    for(int i = 0 ; i < source->CmdListsCount ; i++){
+        target->CmdLists[i] = source->CmdLists[i]->CloneOutput();
+    }
+}
+
+static void render_frame(unsigned int frame_index){
+    PROFILE_FUNCTION();
+    gpu_profiler_begin_frame();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplSDL2_NewFrame();
+
+    g_render.function(g_render.block, &g_render.frames[frame_index]);
+
+    // device objects already exist, see platform_init, so only the cloned
+    // draw data is used here
+    gpu_profiler_begin_pass(GPU_PASS_IMGUI);
+    if (g_imgui_frames[frame_index].Valid){
+        ImGui_ImplOpenGL3_RenderDrawData(&g_imgui_frames[frame_index]);
+    }
+    gpu_profiler_end_pass();
+    SDL_GL_SwapWindow(g_state.window_handle);
+}
+
+static int render_thread_main(void * param){
+    SDL_GL_MakeCurrent(g_state.window_handle, g_state.context_handle);
+    profiler_set_thread_name("render");
+    for(;;){
+        SDL_SemWait(g_render.frame_ready);
+        if (SDL_AtomicGet(&g_render.quit)) break;
+        render_frame(g_render.submitted_index);
+        SDL_SemPost(g_render.frame_done);
+    }
+    SDL_GL_MakeCurrent(g_state.window_handle, nullptr);
+    return 0;
+}
+
+MemoryArena * platform_render_commands(){
+    return &g_render.frames[g_render.write_index];
+}
+
+void platform_init_render_thread(MemoryBlock * command_memory, bool threaded){
+    size_t frame_size = command_memory->size / 2;
+    for(unsigned int i = 0 ; i < 2 ; i++){
+        init_arena(&g_render.frames[i], (char *) command_memory->ptr + i * frame_size, frame_size);
+    }
+    g_render.write_index = 0;
+    g_render.frame_in_flight = false;
+    g_render.thread = nullptr;
+
+    if (threaded == false || g_state.headless) return;
+
+    g_render.frame_ready = SDL_CreateSemaphore(0);
+    g_render.frame_done  = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&g_render.quit, 0);
+
+    // the context can only be current on one thread at a time
+    SDL_GL_MakeCurrent(g_state.window_handle, nullptr);
+    g_render.thread = SDL_CreateThread(render_thread_main, "render", nullptr);
+    if (g_render.thread == nullptr){
+        printf("unable to create render thread, rendering on the main thread : %s\n", SDL_GetError());
+        SDL_GL_MakeCurrent(g_state.window_handle, g_state.context_handle);
+    }
+}
+
+void platform_wait_render_idle(){
+    if (g_render.frame_in_flight){
+        SDL_SemWait(g_render.frame_done);
+        g_render.frame_in_flight = false;
+    }
+}
+
+void platform_begin_rendering(){
+    if (g_state.headless){
+        unsigned int frame_ms = g_state.headless_frame_ms ? g_state.headless_frame_ms : 16;
+        ImGui::GetIO().DeltaTime = frame_ms / 1000.0f;
+    } else {
+        ImGui_ImplSDL2_NewFrame();
+    }
     ImGui::NewFrame();
 }
 
-void platform_end_rendering(){
+void platform_end_rendering(platform_render_function_t function, MemoryBlock * block){
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-    SDL_GL_SwapWindow(g_state.window_handle);
+
+    if (g_state.headless){
+        reset_arena_to_zero(&g_render.frames[g_render.write_index]);
+        return;
+    }
+
+    unsigned int frame_index = g_render.write_index;
+    copy_imgui_draw_data(&g_imgui_frames[frame_index], ImGui::GetDrawData());
+
+    // the render thread has to be done with the other frame before it can
+    // be handed back to the gamespace
+    platform_wait_render_idle();
+
+    g_render.function = function;
+    g_render.block = block;
+    g_render.submitted_index = frame_index;
+
+    if (g_render.thread){
+        g_render.frame_in_flight = true;
+        SDL_SemPost(g_render.frame_ready);
+    } else {
+        render_frame(frame_index);
+    }
+
+    g_render.write_index = frame_index ^ 1;
+    reset_arena_to_zero(&g_render.frames[g_render.write_index]);
 }
 
 void platform_delete_all_data(){
+    platform_end_input();
+    platform_shutdown_workers();
+    platform_shutdown_image_loader();
+    if (g_watcher.fd != -1) close(g_watcher.fd);
+
+    if (g_render.thread){
+        platform_wait_render_idle();
+        SDL_AtomicSet(&g_render.quit, 1);
+        SDL_SemPost(g_render.frame_ready);
+        SDL_WaitThread(g_render.thread, nullptr);
+        g_render.thread = nullptr;
+        SDL_DestroySemaphore(g_render.frame_ready);
+        SDL_DestroySemaphore(g_render.frame_done);
+        SDL_GL_MakeCurrent(g_state.window_handle, g_state.context_handle);
+    }
+    for(unsigned int i = 0 ; i < 2 ; i++){
+        copy_imgui_draw_data(&g_imgui_frames[i], nullptr);
+    }
+
+    if (g_state.headless){
+        ImGui::DestroyContext();
+        return;
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
@@ -6,6 +6,11 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <cstdio>
+
+#include "memory.hh"
+#include "texture_cache.hh"
+
 
 #define     VISIBLEKEYS     128
 #define     FUNCTIONALKEYS  256
@@ -48,6 +53,154 @@ struct SystemStateHandler {
     unsigned int  ticks;
 
     int central_state;
+
+    // no window, GL context or SDL events, the clock advances by 
+    // headless_frame_ms every update (real time when it is 0)
+    bool headless;
+    unsigned int headless_frame_ms;
+};
+
+// input recording. while recording, the state every platform_update_input_state
+// call produces is appended to a file. during playback the state comes from
+// the file instead, SDL events are still drained so the window stays usable
+// and closing it still quits. only what the game reads is recorded (keys,
+// buttons, mouse, event flags and ticks), input taken by ImGui is not
+
+#define INPUT_IDLE          0
+#define INPUT_RECORDING     1
+#define INPUT_PLAYBACK      2
+
+#define INPUT_KEY_BYTES     ((KEYCOUNT + 7) / 8)
+
+// one frame in the file, the previous state of every key and button is the
+// frame before it
+struct InputFrame {
+    unsigned char keys[INPUT_KEY_BYTES];
+    unsigned char buttons;
+    int   central_state;
+    float xpos, ypos;
+    float xrel, yrel;
+    unsigned int ticks;
+};
+
+struct PlatformInputRecorder {
+    int mode;
+    FILE * file;
+
+    // the playback file is mapped, frames point past its header
+    void * mapping;
+    size_t mapping_size;
+    const InputFrame * frames;
+    unsigned int frame_count;
+
+    // frame that the next platform_update_input_state records or plays
+    unsigned int next_frame;
+
+    // input of the person at the keyboard, which the recording replaces
+    KeyboardState live_key;
+};
+
+// worker threads for data parallel jobs, platform_run_parallel hands out 
+// job indices [0, job_count) to the workers and the calling thread and
+// returns once all of them have finished, so no job outlives the call 
+// (which keeps the gamespace library safe to reload between frames)
+
+#define MAX_WORKER_THREADS  16
+
+typedef void (*platform_job_function_t)(void * data, unsigned int job_index);
+
+struct PlatformWorkerPool {
+    SDL_Thread * threads[MAX_WORKER_THREADS];
+    unsigned int thread_count;
+
+    SDL_sem * work_available;
+    SDL_sem * work_finished;
+
+    SDL_atomic_t next_job;
+    SDL_atomic_t quit;
+
+    platform_job_function_t function;
+    void * data;
+    unsigned int job_count;
+};
+
+// background image decoding. requests are decoded to rgba8 by the loader 
+// threads and polled by the gamespace, unlike platform_run_parallel the call 
+// returns right away. the decoding only runs platform code so the gamespace
+// library can be reloaded while requests are still in flight
+
+#define MAX_IMAGE_REQUESTS      64
+#define IMAGE_LOADER_THREADS    2
+
+#define IMAGE_REQUEST_FREE      0
+#define IMAGE_REQUEST_PENDING   1
+#define IMAGE_REQUEST_DECODING  2
+#define IMAGE_REQUEST_DECODED   3
+#define IMAGE_REQUEST_FAILED    4
+
+struct PlatformImageRequest {
+    SDL_atomic_t state;
+    char filepath[256];
+
+    // either decoded by stb_image or pointing into the cooked mapping
+    const unsigned char * pixels;
+    unsigned int width;
+    unsigned int height;
+    CookedTexture cooked;
+};
+
+struct PlatformImageLoader {
+    SDL_Thread * threads[IMAGE_LOADER_THREADS];
+    unsigned int thread_count;
+
+    SDL_sem * requests_available;
+    SDL_atomic_t quit;
+
+    PlatformImageRequest requests[MAX_IMAGE_REQUESTS];
+};
+
+// file change notifications through inotify. the watched directories are
+// drained once per frame in platform_update_input_state and the files that
+// were written (or moved in, as editors that save through a rename do) are
+// listed by full path until the next update
+
+#define MAX_WATCHED_DIRECTORIES 8
+#define MAX_CHANGED_FILES       32
+#define MAX_WATCH_PATH          256
+
+struct PlatformFileWatcher {
+    int fd;
+
+    int  watches[MAX_WATCHED_DIRECTORIES];
+    char directories[MAX_WATCHED_DIRECTORIES][MAX_WATCH_PATH];
+    unsigned int watch_count;
+
+    char changed[MAX_CHANGED_FILES][MAX_WATCH_PATH];
+    unsigned int changed_count;
+};
+
+// render thread, owns the GL context once started. the gamespace writes a
+// frame worth of render commands into one of two command arenas while the 
+// render thread replays the other one through the render function, so the
+// simulation of frame N + 1 overlaps the GL submission of frame N
+
+typedef void (*platform_render_function_t)(MemoryBlock * block, MemoryArena * commands);
+
+struct PlatformRenderThread {
+    SDL_Thread * thread;
+    SDL_sem * frame_ready;
+    SDL_sem * frame_done;
+    SDL_atomic_t quit;
+
+    // frames[write_index] is filled by the gamespace, the other one belongs
+    // to the render thread between platform_end_rendering calls
+    MemoryArena frames[2];
+    unsigned int write_index;
+    bool frame_in_flight;
+
+    platform_render_function_t function;
+    MemoryBlock * block;
+    unsigned int submitted_index;
 };
 
 const SDL_Window * get_window_handle();
@@ -71,12 +224,47 @@ bool is_button_released(int buttoncode);
 glm::vec2 mouse_window_pos();
 glm::vec2 mouse_window_motion();
 unsigned int get_ticks_since_start();
+// keys as they are on the keyboard, also during playback, for the controls
+// of the platform itself
+bool is_live_key_pressed(int keycode);
+
+int  platform_begin_input_recording(const char * path);
+int  platform_begin_input_playback(const char * path);
+// stops either of them
+void platform_end_input();
+int  platform_input_mode();
+unsigned int platform_input_frame();
+unsigned int platform_input_frame_count();
+void platform_seek_input(unsigned int frame);
+
+unsigned int platform_worker_count();
+unsigned int platform_thread_index();
+void platform_run_parallel(platform_job_function_t function, void * data, unsigned int job_count);
+
+// returns the request id or -1 when every request slot is taken
+int  platform_request_image(const char * filepath);
+// returns the request state, pixels / width / height are set once decoded
+int  platform_poll_image(int request, const unsigned char ** pixels, unsigned int * width, unsigned int * height);
+// frees the decoded pixels, only valid once the request is decoded or failed
+void platform_release_image(int request);
+
+int          platform_watch_directory(const char * path);
+unsigned int platform_changed_file_count();
+const char * platform_changed_file(unsigned int index);
+
+MemoryArena * platform_render_commands();
 
 void opengl_debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar * message, const void * userParam);
 
 void platform_init(const char * window, unsigned int width, unsigned int height, unsigned int flags);
+// null render backend, the render commands and ImGui draw data of a frame 
+// are built as usual and then dropped
+void platform_init_headless(unsigned int width, unsigned int height, unsigned int frame_ms);
+bool platform_is_headless();
+void platform_init_render_thread(MemoryBlock * command_memory, bool threaded);
+void platform_wait_render_idle();
 void platform_begin_rendering();
-void platform_end_rendering();
+void platform_end_rendering(platform_render_function_t function, MemoryBlock * block);
 void platform_update_input_state();
 void platform_delete_all_data();
 
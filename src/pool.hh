@@ -0,0 +1,148 @@
+#ifndef POOL_HH
+#define POOL_HH
+
+#include <cstdint>
+
+#include "memory.hh"
+
+// @note: typed pool on top of a MemoryArena. the live objects are kept
+//        packed at the front of `items` so iterating over them is a plain
+//        loop over [0, count), freeing moves the last object into the hole.
+//        objects are referred to by handles that go through a slot table,
+//        the slot knows where its object sits in `items` and free slots are
+//        linked through the same field. every free bumps the generation of
+//        the slot, so a handle to a freed object no longer resolves
+
+typedef uint32_t PoolHandle;
+
+#define POOL_INDEX_BITS         20
+#define POOL_GENERATION_BITS    12
+#define POOL_INDEX_MASK         ((1u << POOL_INDEX_BITS) - 1)
+#define POOL_GENERATION_MASK    ((1u << POOL_GENERATION_BITS) - 1)
+#define POOL_MAX_CAPACITY       (1u << POOL_INDEX_BITS)
+
+// generations start at 1 so that this never names a live object
+#define POOL_NULL_HANDLE        0
+
+struct PoolSlot {
+    // dense index while the slot is used, next free slot otherwise
+    uint32_t index;
+    uint32_t generation;
+};
+
+template <typename T>
+struct Pool {
+    T * items;
+    uint32_t * item_slots;
+    PoolSlot * slots;
+
+    uint32_t capacity;
+    uint32_t count;
+    // head of the free slot list, capacity when it is empty
+    uint32_t free_slot;
+};
+
+inline PoolHandle pool_make_handle(uint32_t slot, uint32_t generation){
+    return (generation << POOL_INDEX_BITS) | slot;
+}
+
+inline uint32_t pool_handle_slot(PoolHandle handle){
+    return handle & POOL_INDEX_MASK;
+}
+
+inline uint32_t pool_handle_generation(PoolHandle handle){
+    return handle >> POOL_INDEX_BITS;
+}
+
+template <typename T>
+int init_pool(Pool<T> * pool, MemoryArena * arena, uint32_t capacity){
+    *pool = {};
+    if (capacity == 0 || capacity > POOL_MAX_CAPACITY) return -1;
+
+    pool->items      = ALLOCATE_ARRAY(arena, T, capacity);
+    pool->item_slots = ALLOCATE_ARRAY(arena, uint32_t, capacity);
+    pool->slots      = ALLOCATE_ARRAY(arena, PoolSlot, capacity);
+    if (pool->items == nullptr || pool->item_slots == nullptr || pool->slots == nullptr) return -1;
+
+    pool->capacity = capacity;
+    for(uint32_t i = 0 ; i < capacity ; i++){
+        pool->slots[i].index = i + 1;
+        pool->slots[i].generation = 1;
+    }
+    pool->free_slot = 0;
+    pool->count = 0;
+    return 0;
+}
+
+// returns POOL_NULL_HANDLE when the pool is full, the object is zeroed
+template <typename T>
+PoolHandle pool_alloc(Pool<T> * pool, T ** result = nullptr){
+    if (pool->free_slot == pool->capacity) return POOL_NULL_HANDLE;
+
+    uint32_t slot = pool->free_slot;
+    PoolSlot * entry = pool->slots + slot;
+    pool->free_slot = entry->index;
+
+    entry->index = pool->count;
+    pool->item_slots[pool->count] = slot;
+    pool->items[pool->count] = {};
+    if (result) *result = pool->items + pool->count;
+    pool->count += 1;
+
+    return pool_make_handle(slot, entry->generation);
+}
+
+// nullptr for freed objects and handles from before a pool_clear
+template <typename T>
+T * pool_get(Pool<T> * pool, PoolHandle handle){
+    uint32_t slot = pool_handle_slot(handle);
+    if (slot >= pool->capacity) return nullptr;
+    PoolSlot * entry = pool->slots + slot;
+    if (entry->generation != pool_handle_generation(handle)) return nullptr;
+    return pool->items + entry->index;
+}
+
+// handle of the object at a dense index, for loops over items
+template <typename T>
+PoolHandle pool_handle(Pool<T> * pool, uint32_t index){
+    uint32_t slot = pool->item_slots[index];
+    return pool_make_handle(slot, pool->slots[slot].generation);
+}
+
+static inline void pool_release_slot(PoolSlot * slots, uint32_t slot, uint32_t * free_slot){
+    PoolSlot * entry = slots + slot;
+    // 0 is skipped when the generation wraps, see POOL_NULL_HANDLE
+    entry->generation = (entry->generation + 1) & POOL_GENERATION_MASK;
+    if (entry->generation == 0) entry->generation = 1;
+    entry->index = *free_slot;
+    *free_slot = slot;
+}
+
+// @note: the last object moves into the freed place, pointers into items
+//        are only valid until the next free
+template <typename T>
+void pool_free(Pool<T> * pool, PoolHandle handle){
+    if (pool_get(pool, handle) == nullptr) return;
+
+    uint32_t slot = pool_handle_slot(handle);
+    uint32_t index = pool->slots[slot].index;
+    uint32_t last = pool->count - 1;
+    if (index != last){
+        pool->items[index] = pool->items[last];
+        pool->item_slots[index] = pool->item_slots[last];
+        pool->slots[pool->item_slots[index]].index = index;
+    }
+    pool->count -= 1;
+    pool_release_slot(pool->slots, slot, &pool->free_slot);
+}
+
+// frees every object, handles given out before stop resolving
+template <typename T>
+void pool_clear(Pool<T> * pool){
+    while(pool->count){
+        pool->count -= 1;
+        pool_release_slot(pool->slots, pool->item_slots[pool->count], &pool->free_slot);
+    }
+}
+
+#endif
@@ -0,0 +1,239 @@
+#include "profiler.hh"
+
+#ifdef BREAD_PROFILE
+
+#include <SDL2/SDL.h>
+#include <imgui.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+ProfilerState * g_profiler = nullptr;
+SDL_mutex * g_profiler_lock = nullptr;
+
+static thread_local int t_profiler_thread = -1;
+
+uint64_t profiler_now(){
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ull + (uint64_t) time.tv_nsec;
+}
+
+void profiler_init(MemoryBlock * memory){
+    MemoryArena arena = {};
+    arena.ptr = memory->ptr;
+    arena.size = memory->size;
+
+    ProfilerState * state = ALLOCATE_STRUCT(&arena, ProfilerState);
+    if (state == nullptr){
+        printf("profiler :: memory block too small\n");
+        return;
+    }
+    memset(state, 0, sizeof(ProfilerState));
+
+    // the rest of the block is split evenly between the thread rings
+    size_t ring_bytes = (arena.size - arena.cur) / PROFILER_MAX_THREADS;
+    size_t ring_events = ring_bytes / sizeof(ProfilerEvent) - 1;
+    for(unsigned int i = 0 ; i < PROFILER_MAX_THREADS ; i++){
+        state->threads[i].events = ALLOCATE_ARRAY(&arena, ProfilerEvent, ring_events);
+        state->threads[i].capacity = ring_events;
+    }
+
+    g_profiler_lock = SDL_CreateMutex();
+    g_profiler = state;
+}
+
+static ProfilerThread * get_profiler_thread(){
+    if (t_profiler_thread == -1){
+        SDL_LockMutex(g_profiler_lock);
+        if (g_profiler->thread_count < PROFILER_MAX_THREADS){
+            t_profiler_thread = g_profiler->thread_count;
+            snprintf(g_profiler->threads[t_profiler_thread].name, sizeof(g_profiler->threads[0].name), "thread %d", t_profiler_thread);
+            g_profiler->thread_count += 1;
+        }
+        SDL_UnlockMutex(g_profiler_lock);
+        if (t_profiler_thread == -1) return nullptr;
+    }
+    return &g_profiler->threads[t_profiler_thread];
+}
+
+void profiler_set_thread_name(const char * name){
+    if (g_profiler == nullptr) return;
+    ProfilerThread * thread = get_profiler_thread();
+    if (thread == nullptr) return;
+    snprintf(thread->name, sizeof(thread->name), "%s", name);
+}
+
+uint16_t profiler_register_zone(const char * name){
+    if (g_profiler == nullptr) return 0;
+
+    SDL_LockMutex(g_profiler_lock);
+    uint16_t zone = 0;
+    for(; zone < g_profiler->zone_count ; zone++){
+        if (strncmp(g_profiler->zone_names[zone], name, PROFILER_MAX_ZONE_NAME - 1) == 0) break;
+    }
+    if (zone == g_profiler->zone_count){
+        if (g_profiler->zone_count < PROFILER_MAX_ZONES){
+            snprintf(g_profiler->zone_names[zone], PROFILER_MAX_ZONE_NAME, "%s", name);
+            g_profiler->zone_count += 1;
+        } else {
+            printf("profiler :: out of zones, %s shares the last one\n", name);
+            zone = PROFILER_MAX_ZONES - 1;
+        }
+    }
+    SDL_UnlockMutex(g_profiler_lock);
+    return zone;
+}
+
+unsigned int profiler_enter(){
+    if (g_profiler == nullptr) return 0;
+    ProfilerThread * thread = get_profiler_thread();
+    if (thread == nullptr) return 0;
+    thread->depth += 1;
+    return thread->depth - 1;
+}
+
+void profiler_record(uint16_t zone, uint64_t begin, unsigned int depth){
+    if (g_profiler == nullptr) return;
+    ProfilerThread * thread = get_profiler_thread();
+    if (thread == nullptr) return;
+
+    thread->depth -= 1;
+    if (g_profiler->paused) return;
+
+    ProfilerEvent * event = thread->events + (thread->written % thread->capacity);
+    event->begin = begin;
+    event->end   = profiler_now();
+    event->zone  = zone;
+    event->depth = (uint16_t) depth;
+    __atomic_store_n(&thread->written, thread->written + 1, __ATOMIC_RELEASE);
+}
+
+void profiler_frame_mark(){
+    if (g_profiler == nullptr || g_profiler->paused) return;
+    g_profiler->frame_begin[g_profiler->frame_count % PROFILER_FRAME_HISTORY] = profiler_now();
+    g_profiler->frame_count += 1;
+}
+
+static const ImU32 zone_colors[] = {
+    IM_COL32(0x4e, 0x79, 0xa7, 0xff), IM_COL32(0xf2, 0x8e, 0x2b, 0xff),
+    IM_COL32(0xe1, 0x57, 0x59, 0xff), IM_COL32(0x76, 0xb7, 0xb2, 0xff),
+    IM_COL32(0x59, 0xa1, 0x4f, 0xff), IM_COL32(0xed, 0xc9, 0x48, 0xff),
+    IM_COL32(0xb0, 0x7a, 0xa1, 0xff), IM_COL32(0x9c, 0x75, 0x5f, 0xff),
+};
+
+// @note: flame chart of the last complete frame, one band per thread with one
+//        row per nesting level
+void profiler_draw_panel(){
+    if (g_profiler == nullptr) return;
+
+    ImGui::Begin("CPU profiler");
+    ImGui::Checkbox("paused", &g_profiler->paused);
+    ImGui::SameLine();
+    if (ImGui::Button("export chrome trace")){
+        if (profiler_export_chrome_trace("profile.json") == 0){
+            printf("profiler :: trace written to profile.json\n");
+        }
+    }
+
+    if (g_profiler->frame_count < 2){
+        ImGui::End();
+        return;
+    }
+
+    uint64_t frame_end   = g_profiler->frame_begin[(g_profiler->frame_count - 1) % PROFILER_FRAME_HISTORY];
+    uint64_t frame_begin = g_profiler->frame_begin[(g_profiler->frame_count - 2) % PROFILER_FRAME_HISTORY];
+    double frame_length  = (double) (frame_end - frame_begin);
+    ImGui::Text("frame : %.3f ms", frame_length / 1000000.0);
+
+    const float row_height = 18.0f;
+    ImDrawList * draw_list = ImGui::GetWindowDrawList();
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = ImGui::GetContentRegionAvail().x;
+    float y = origin.y;
+
+    for(unsigned int t = 0 ; t < g_profiler->thread_count ; t++){
+        ProfilerThread * thread = &g_profiler->threads[t];
+        draw_list->AddText(ImVec2(origin.x, y), IM_COL32(0xff, 0xff, 0xff, 0xff), thread->name);
+        y += row_height;
+
+        uint64_t written = __atomic_load_n(&thread->written, __ATOMIC_ACQUIRE);
+        uint64_t available = written < thread->capacity ? written : thread->capacity;
+        unsigned int max_depth = 0;
+
+        for(uint64_t i = written - available ; i < written ; i++){
+            ProfilerEvent event = thread->events[i % thread->capacity];
+            if (event.end < frame_begin || event.begin > frame_end) continue;
+
+            uint64_t begin = event.begin < frame_begin ? frame_begin : event.begin;
+            uint64_t end   = event.end > frame_end ? frame_end : event.end;
+            float x0 = origin.x + (float) ((begin - frame_begin) / frame_length) * width;
+            float x1 = origin.x + (float) ((end - frame_begin) / frame_length) * width;
+            if (x1 - x0 < 1.0f) x1 = x0 + 1.0f;
+            float y0 = y + event.depth * row_height;
+
+            ImVec2 min = ImVec2(x0, y0);
+            ImVec2 max = ImVec2(x1, y0 + row_height - 1.0f);
+            draw_list->AddRectFilled(min, max, zone_colors[event.zone % IM_ARRAYSIZE(zone_colors)]);
+            if (x1 - x0 > 30.0f){
+                draw_list->PushClipRect(min, max, true);
+                draw_list->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32(0x00, 0x00, 0x00, 0xff), g_profiler->zone_names[event.zone]);
+                draw_list->PopClipRect();
+            }
+            if (ImGui::IsMouseHoveringRect(min, max)){
+                ImGui::SetTooltip("%s : %.3f ms", g_profiler->zone_names[event.zone], (event.end - event.begin) / 1000000.0);
+            }
+            max_depth = event.depth + 1 > max_depth ? event.depth + 1 : max_depth;
+        }
+        y += max_depth * row_height + row_height * 0.5f;
+    }
+
+    ImGui::Dummy(ImVec2(width, y - origin.y));
+    ImGui::End();
+}
+
+// events recorded on all threads since init, including the ones the rings
+// have already overwritten
+uint64_t profiler_event_count(){
+    if (g_profiler == nullptr) return 0;
+    uint64_t count = 0;
+    for(unsigned int t = 0 ; t < g_profiler->thread_count ; t++){
+        count += __atomic_load_n(&g_profiler->threads[t].written, __ATOMIC_ACQUIRE);
+    }
+    return count;
+}
+
+// writes every event still in the rings as chrome://tracing complete events
+int profiler_export_chrome_trace(const char * filepath){
+    if (g_profiler == nullptr) return -1;
+
+    FILE * file = fopen(filepath, "w");
+    if (file == nullptr){
+        printf("profiler :: unable to open %s\n", filepath);
+        return -1;
+    }
+
+    fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    for(unsigned int t = 0 ; t < g_profiler->thread_count ; t++){
+        ProfilerThread * thread = &g_profiler->threads[t];
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", t, thread->name);
+        first = false;
+
+        uint64_t written = __atomic_load_n(&thread->written, __ATOMIC_ACQUIRE);
+        uint64_t available = written < thread->capacity ? written : thread->capacity;
+        for(uint64_t i = written - available ; i < written ; i++){
+            ProfilerEvent event = thread->events[i % thread->capacity];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    g_profiler->zone_names[event.zone], t,
+                    event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include "memory.hh"
+
+#include <cstdint>
+
+// Hierarchical CPU scope profiler. zones are recorded into one ring buffer 
+// per thread, inside a memory block owned by the platform so the recorded
+// data (and the zone ids) survive reloading the gamespace library. zone names
+// are interned by content for the same reason, a call site in a reloaded 
+// library maps back to the zone it had before.
+//
+// everything compiles away unless BREAD_PROFILE is defined
+
+#define PROFILER_MAX_THREADS        32
+#define PROFILER_MAX_ZONES          512
+#define PROFILER_MAX_ZONE_NAME      64
+#define PROFILER_MAX_DEPTH          32
+#define PROFILER_FRAME_HISTORY      64
+
+struct ProfilerEvent {
+    uint64_t begin;
+    uint64_t end;
+    uint16_t zone;
+    uint16_t depth;
+};
+
+struct ProfilerThread {
+    ProfilerEvent * events;
+    uint64_t capacity;
+    uint64_t written;       // total events ever written, ring index is written % capacity
+    unsigned int depth;
+    char name[32];
+};
+
+struct ProfilerState {
+    ProfilerThread threads[PROFILER_MAX_THREADS];
+    unsigned int thread_count;
+
+    char zone_names[PROFILER_MAX_ZONES][PROFILER_MAX_ZONE_NAME];
+    unsigned int zone_count;
+
+    // start of the last frames on the main thread
+    uint64_t frame_begin[PROFILER_FRAME_HISTORY];
+    uint64_t frame_count;
+
+    bool paused;
+};
+
+#ifdef BREAD_PROFILE
+
+uint64_t profiler_now();
+void profiler_init(MemoryBlock * memory);
+void profiler_set_thread_name(const char * name);
+uint16_t profiler_register_zone(const char * name);
+void profiler_record(uint16_t zone, uint64_t begin, unsigned int depth);
+unsigned int profiler_enter();
+void profiler_frame_mark();
+void profiler_draw_panel();
+uint64_t profiler_event_count();
+int profiler_export_chrome_trace(const char * filepath);
+
+struct ProfilerScope {
+    uint16_t zone;
+    unsigned int depth;
+    uint64_t begin;
+
+    ProfilerScope(uint16_t zone_id) : zone(zone_id), depth(profiler_enter()), begin(profiler_now()) {}
+    ~ProfilerScope() { profiler_record(zone, begin, depth); }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+
+#define PROFILE_SCOPE(name) \
+    static uint16_t PROFILE_CONCAT(profile_zone_, __LINE__) = profiler_register_zone(name); \
+    ProfilerScope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_zone_, __LINE__))
+#define PROFILE_FUNCTION()  PROFILE_SCOPE(__func__)
+
+#else
+
+inline void profiler_init(MemoryBlock * memory) {}
+inline void profiler_set_thread_name(const char * name) {}
+inline void profiler_frame_mark() {}
+inline void profiler_draw_panel() {}
+inline uint64_t profiler_event_count() { return 0; }
+inline int  profiler_export_chrome_trace(const char * filepath) { return -1; }
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+
+#endif
+
+#endif
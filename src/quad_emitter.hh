@@ -0,0 +1,123 @@
+#ifndef QUAD_EMITTER_HH
+#define QUAD_EMITTER_HH
+
+// Single quad emitters of Renderer2D, header only so that the benchmark in
+// tests/render_quad_test.cc compiles the same code as the gamespace
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+#include "gamespace.hh"
+
+// quad emitter features, combined into the template argument of render_quad
+// so that every variant is resolved at compile time
+#define QUAD_COLORED    (1 << 0)
+#define QUAD_TEXTURED   (1 << 1)
+#define QUAD_ROTATED    (1 << 2)
+
+// @note: writes the 4 corners straight into quad slot `quad` of the renderer
+//        buffers, features that are not requested fall back to white color and
+//        the full (0,0)-(1,1) uv so the uv and color buffers always stay in lock 
+//        step with the vertices. the added_* counters are not touched so that 
+//        several threads can fill disjoint slots of the same renderer
+template<unsigned int FEATURES>
+void write_quad(
+        Renderer2D * renderer,
+        size_t quad,
+        glm::vec2 pos,
+        glm::vec2 dim,
+        glm::vec4 color = glm::vec4(1.0f),
+        glm::vec2 uv_pos = glm::vec2(0.0f),
+        glm::vec2 uv_dim = glm::vec2(1.0f),
+        glm::vec2 center = glm::vec2(0.0f),
+        float rot = 0.0f){
+
+    float * vertex          = renderer->mem_vertex_buffer + quad * 2 * 4;
+    float * vertex_color    = renderer->mem_color_buffer + quad * 4 * 4;
+    float * vertex_uv       = renderer->mem_uv_coord_buffer + quad * 2 * 4;
+    unsigned int * index    = renderer->mem_index_buffer + quad * 6;
+    unsigned int base       = (unsigned int) quad * 4;
+
+    // corner order : (x0, y0) (x0, y1) (x1, y1) (x1, y0)
+    float x0 = pos.x;
+    float y0 = pos.y;
+    float x1 = pos.x + dim.x;
+    float y1 = pos.y + dim.y;
+
+    if constexpr ((FEATURES & QUAD_ROTATED) != 0){
+        // 2x2 rotation around the center, same as glm::rotate around the z axis
+        float c = cosf(rot);
+        float s = sinf(rot);
+        x0 -= center.x; x1 -= center.x;
+        y0 -= center.y; y1 -= center.y;
+
+        vertex[0] = center.x + x0 * c - y0 * s; vertex[1] = center.y + x0 * s + y0 * c;
+        vertex[2] = center.x + x0 * c - y1 * s; vertex[3] = center.y + x0 * s + y1 * c;
+        vertex[4] = center.x + x1 * c - y1 * s; vertex[5] = center.y + x1 * s + y1 * c;
+        vertex[6] = center.x + x1 * c - y0 * s; vertex[7] = center.y + x1 * s + y0 * c;
+    } else {
+        vertex[0] = x0; vertex[1] = y0;
+        vertex[2] = x0; vertex[3] = y1;
+        vertex[4] = x1; vertex[5] = y1;
+        vertex[6] = x1; vertex[7] = y0;
+    }
+
+    if constexpr ((FEATURES & QUAD_COLORED) == 0){
+        color = glm::vec4(1.0f);
+    }
+    for(unsigned int i = 0; i < 4 ; i++){
+        vertex_color[i * 4 + 0] = color.x;
+        vertex_color[i * 4 + 1] = color.y;
+        vertex_color[i * 4 + 2] = color.z;
+        vertex_color[i * 4 + 3] = color.w;
+    }
+
+    if constexpr ((FEATURES & QUAD_TEXTURED) == 0){
+        uv_pos = glm::vec2(0.0f);
+        uv_dim = glm::vec2(1.0f);
+    }
+    vertex_uv[0] = uv_pos.x;            vertex_uv[1] = uv_pos.y;
+    vertex_uv[2] = uv_pos.x;            vertex_uv[3] = uv_pos.y + uv_dim.y;
+    vertex_uv[4] = uv_pos.x + uv_dim.x; vertex_uv[5] = uv_pos.y + uv_dim.y;
+    vertex_uv[6] = uv_pos.x + uv_dim.x; vertex_uv[7] = uv_pos.y;
+
+    index[0] = base + 0;
+    index[1] = base + 1;
+    index[2] = base + 2;
+    index[3] = base + 0;
+    index[4] = base + 2;
+    index[5] = base + 3;
+}
+
+// advances the renderer counters by count quads
+inline void reserve_quads(Renderer2D * renderer, size_t count){
+    renderer->added_vertices  += count * 2 * 4;
+    renderer->added_colors    += count * 4 * 4;
+    renderer->added_uv_coords += count * 2 * 4;
+    renderer->added_indices   += count * 6;
+}
+
+template<unsigned int FEATURES>
+void render_quad(
+        Renderer2D * renderer,
+        glm::vec2 pos,
+        glm::vec2 dim,
+        glm::vec4 color = glm::vec4(1.0f),
+        glm::vec2 uv_pos = glm::vec2(0.0f),
+        glm::vec2 uv_dim = glm::vec2(1.0f),
+        glm::vec2 center = glm::vec2(0.0f),
+        float rot = 0.0f){
+
+    // all the buffers grow together so checking the index buffer is enough
+    if (renderer->added_indices + 6 > renderer->total_indices){
+        printf("renderer :: buffer entirly full\n");
+        return;
+    }
+
+    write_quad<FEATURES>(renderer, renderer->added_indices / 6, pos, dim, color, uv_pos, uv_dim, center, rot);
+    reserve_quads(renderer, 1);
+}
+
+#endif
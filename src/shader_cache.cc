@@ -0,0 +1,127 @@
+#include "shader_cache.hh"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t fnv1a(uint64_t hash, const char * text){
+    if (text == nullptr) return hash;
+    for(const char * c = text ; *c ; c++){
+        hash ^= (unsigned char) *c;
+        hash *= 1099511628211ull;
+    }
+    // separator so that ("ab", "c") and ("a", "bc") hash differently
+    hash ^= 0xff;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+static void shader_cache_path(uint64_t key, char * path, size_t size){
+    snprintf(path, size, "%s/%016llx.bin", SHADER_CACHE_DIRECTORY, (unsigned long long) key);
+}
+
+static bool shader_cache_supported(){
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    return format_count > 0;
+}
+
+uint64_t shader_cache_key(const char * vertex, const char * fragment){
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, vertex);
+    hash = fnv1a(hash, fragment);
+    hash = fnv1a(hash, (const char *) glGetString(GL_VENDOR));
+    hash = fnv1a(hash, (const char *) glGetString(GL_RENDERER));
+    hash = fnv1a(hash, (const char *) glGetString(GL_VERSION));
+    return hash;
+}
+
+GLuint shader_cache_load(uint64_t key){
+    if (shader_cache_supported() == false) return 0;
+
+    char path[128];
+    shader_cache_path(key, path, sizeof(path));
+    FILE * file = fopen(path, "rb");
+    if (file == nullptr) return 0;
+
+    // the length comes from the file, a truncated or damaged file must not
+    // be able to ask for more than the file holds
+    struct stat info;
+    ShaderCacheHeader header = {};
+    if (fstat(fileno(file), &info) != 0
+            || fread(&header, sizeof(header), 1, file) != 1 
+            || header.magic != SHADER_CACHE_MAGIC 
+            || header.version != SHADER_CACHE_VERSION
+            || header.length == 0
+            || (uint64_t) header.length != (uint64_t) info.st_size - sizeof(header)){
+        fclose(file);
+        return 0;
+    }
+
+    void * binary = malloc(header.length);
+    if (binary == nullptr){
+        fclose(file);
+        return 0;
+    }
+    size_t read = fread(binary, 1, header.length, file);
+    fclose(file);
+    if (read != header.length){
+        free(binary);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary, header.length);
+    free(binary);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE){
+        printf("shader cache :: binary %s rejected by the driver\n", path);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+void shader_cache_store(uint64_t key, GLuint program){
+    if (shader_cache_supported() == false) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    void * binary = malloc(length);
+    if (binary == nullptr) return;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary);
+
+    ShaderCacheHeader header = {};
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.format = format;
+    header.length = length;
+
+    char path[128];
+    char temporary[160];
+    shader_cache_path(key, path, sizeof(path));
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int) getpid());
+    mkdir(SHADER_CACHE_DIRECTORY, 0755);
+
+    FILE * file = fopen(temporary, "wb");
+    if (file == nullptr){
+        printf("shader cache :: unable to write %s\n", temporary);
+        free(binary);
+        return;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(binary, 1, length, file) == (size_t) length;
+    fclose(file);
+    free(binary);
+
+    if (written == false || rename(temporary, path) != 0){
+        printf("shader cache :: unable to write %s\n", path);
+        unlink(temporary);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef SHADER_CACHE_HH
+#define SHADER_CACHE_HH
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// Linked program binaries cached on disk with glGetProgramBinary. the key
+// hashes the shader sources together with the GL vendor, renderer and 
+// version strings so a driver update never loads a stale binary, and a 
+// binary the driver refuses anyway is treated as a miss
+
+#define SHADER_CACHE_DIRECTORY  "shader_cache"
+#define SHADER_CACHE_MAGIC      0x48535242      // "BRSH"
+#define SHADER_CACHE_VERSION    1
+
+struct ShaderCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+};
+
+uint64_t shader_cache_key(const char * vertex, const char * fragment);
+
+// returns the linked program or 0 on a miss
+GLuint shader_cache_load(uint64_t key);
+void   shader_cache_store(uint64_t key, GLuint program);
+
+#endif
@@ -0,0 +1,209 @@
+#include "sprite_batch.hh"
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static void generate_sprite_vertices_scalar(
+        const SpriteBatch * batch,
+        unsigned int first,
+        unsigned int count,
+        float * vertices,
+        float * colors,
+        float * uvs){
+    for(unsigned int i = first ; i < first + count ; i++){
+        float hx = batch->dim_x[i] * 0.5f;
+        float hy = batch->dim_y[i] * 0.5f;
+        float px = batch->pivot_x ? batch->pivot_x[i] : batch->pos_x[i];
+        float py = batch->pivot_y ? batch->pivot_y[i] : batch->pos_y[i];
+        float ox = batch->pos_x[i] - px;
+        float oy = batch->pos_y[i] - py;
+        float c = cosf(batch->rot[i]);
+        float s = sinf(batch->rot[i]);
+
+        float cx[4] = { ox - hx, ox - hx, ox + hx, ox + hx };
+        float cy[4] = { oy - hy, oy + hy, oy + hy, oy - hy };
+        for(unsigned int k = 0 ; k < 4 ; k++){
+            vertices[k * 2 + 0] = px + cx[k] * c - cy[k] * s;
+            vertices[k * 2 + 1] = py + cx[k] * s + cy[k] * c;
+        }
+
+        float u0 = batch->uv_x[i], u1 = batch->uv_x[i] + batch->uv_w[i];
+        float v0 = batch->uv_y[i], v1 = batch->uv_y[i] + batch->uv_h[i];
+        uvs[0] = u0; uvs[1] = v0;
+        uvs[2] = u0; uvs[3] = v1;
+        uvs[4] = u1; uvs[5] = v1;
+        uvs[6] = u1; uvs[7] = v0;
+
+        for(unsigned int k = 0 ; k < 4 ; k++){
+            for(unsigned int j = 0 ; j < 4 ; j++){
+                colors[k * 4 + j] = batch->color ? batch->color[i * 4 + j] : 1.0f;
+            }
+        }
+
+        vertices += 8;
+        uvs += 8;
+        colors += 16;
+    }
+}
+
+#if defined(__SSE2__)
+
+// @note: sin and cos of 4 angles at once, range reduced to [-pi/4, pi/4] by
+//        quadrant and evaluated with the cephes minimax polynomials, the error
+//        is around 1e-7 which is plenty for sprite corners
+static inline void sincos_ps(__m128 x, __m128 * out_sin, __m128 * out_cos){
+    const __m128 two_over_pi = _mm_set1_ps(0.63661977236758134f);
+    const __m128 pio2_hi     = _mm_set1_ps(1.5703125f);
+    const __m128 pio2_mid    = _mm_set1_ps(4.837512969970703125e-4f);
+    const __m128 pio2_lo     = _mm_set1_ps(7.54978995489188216e-8f);
+
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, two_over_pi));
+    __m128  q        = _mm_cvtepi32_ps(quadrant);
+
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, pio2_hi));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, pio2_mid));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, pio2_lo));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 sin_r = _mm_set1_ps(-1.9515295891e-4f);
+    sin_r = _mm_add_ps(_mm_mul_ps(sin_r, r2), _mm_set1_ps(8.3321608736e-3f));
+    sin_r = _mm_add_ps(_mm_mul_ps(sin_r, r2), _mm_set1_ps(-1.6666654611e-1f));
+    sin_r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sin_r, r2), r), r);
+
+    __m128 cos_r = _mm_set1_ps(2.443315711809948e-5f);
+    cos_r = _mm_add_ps(_mm_mul_ps(cos_r, r2), _mm_set1_ps(-1.388731625493765e-3f));
+    cos_r = _mm_add_ps(_mm_mul_ps(cos_r, r2), _mm_set1_ps(4.166664568298827e-2f));
+    cos_r = _mm_mul_ps(_mm_mul_ps(cos_r, r2), r2);
+    cos_r = _mm_add_ps(_mm_sub_ps(cos_r, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // odd quadrants swap sin and cos, quadrant 1, 2 negate cos and 2, 3 negate sin
+    __m128i one      = _mm_set1_epi32(1);
+    __m128i two      = _mm_set1_epi32(2);
+    __m128  swap     = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+    __m128  sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+    __m128  cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+    __m128 s = _mm_or_ps(_mm_and_ps(swap, cos_r), _mm_andnot_ps(swap, sin_r));
+    __m128 c = _mm_or_ps(_mm_and_ps(swap, sin_r), _mm_andnot_ps(swap, cos_r));
+
+    *out_sin = _mm_xor_ps(s, sin_sign);
+    *out_cos = _mm_xor_ps(c, cos_sign);
+}
+
+// takes the 4 corners of 4 sprites as (x, y) registers and writes them out
+// as 8 consecutive (x, y) pairs per sprite
+static inline void store_corners_transposed(float * out,
+        __m128 x0, __m128 y0, __m128 x1, __m128 y1,
+        __m128 x2, __m128 y2, __m128 x3, __m128 y3){
+    __m128 a0 = _mm_unpacklo_ps(x0, y0), b0 = _mm_unpackhi_ps(x0, y0);
+    __m128 a1 = _mm_unpacklo_ps(x1, y1), b1 = _mm_unpackhi_ps(x1, y1);
+    __m128 a2 = _mm_unpacklo_ps(x2, y2), b2 = _mm_unpackhi_ps(x2, y2);
+    __m128 a3 = _mm_unpacklo_ps(x3, y3), b3 = _mm_unpackhi_ps(x3, y3);
+
+    _mm_storeu_ps(out +  0, _mm_movelh_ps(a0, a1));
+    _mm_storeu_ps(out +  4, _mm_movelh_ps(a2, a3));
+    _mm_storeu_ps(out +  8, _mm_movehl_ps(a1, a0));
+    _mm_storeu_ps(out + 12, _mm_movehl_ps(a3, a2));
+    _mm_storeu_ps(out + 16, _mm_movelh_ps(b0, b1));
+    _mm_storeu_ps(out + 20, _mm_movelh_ps(b2, b3));
+    _mm_storeu_ps(out + 24, _mm_movehl_ps(b1, b0));
+    _mm_storeu_ps(out + 28, _mm_movehl_ps(b3, b2));
+}
+
+static void generate_sprite_vertices_sse(
+        const SpriteBatch * batch,
+        unsigned int first,
+        unsigned int count,
+        float * vertices,
+        float * colors,
+        float * uvs){
+    const __m128 half  = _mm_set1_ps(0.5f);
+    const __m128 white = _mm_set1_ps(1.0f);
+
+    for(unsigned int i = first ; i < first + count ; i += 4){
+        __m128 pos_x = _mm_loadu_ps(batch->pos_x + i);
+        __m128 pos_y = _mm_loadu_ps(batch->pos_y + i);
+        __m128 hx    = _mm_mul_ps(_mm_loadu_ps(batch->dim_x + i), half);
+        __m128 hy    = _mm_mul_ps(_mm_loadu_ps(batch->dim_y + i), half);
+        __m128 px    = batch->pivot_x ? _mm_loadu_ps(batch->pivot_x + i) : pos_x;
+        __m128 py    = batch->pivot_y ? _mm_loadu_ps(batch->pivot_y + i) : pos_y;
+        __m128 ox    = _mm_sub_ps(pos_x, px);
+        __m128 oy    = _mm_sub_ps(pos_y, py);
+
+        __m128 s, c;
+        sincos_ps(_mm_loadu_ps(batch->rot + i), &s, &c);
+
+        // corner offsets relative to the pivot before rotation
+        __m128 left   = _mm_sub_ps(ox, hx);
+        __m128 right  = _mm_add_ps(ox, hx);
+        __m128 bottom = _mm_sub_ps(oy, hy);
+        __m128 top    = _mm_add_ps(oy, hy);
+
+        __m128 left_c   = _mm_mul_ps(left, c),   left_s   = _mm_mul_ps(left, s);
+        __m128 right_c  = _mm_mul_ps(right, c),  right_s  = _mm_mul_ps(right, s);
+        __m128 bottom_c = _mm_mul_ps(bottom, c), bottom_s = _mm_mul_ps(bottom, s);
+        __m128 top_c    = _mm_mul_ps(top, c),    top_s    = _mm_mul_ps(top, s);
+
+        store_corners_transposed(vertices,
+                _mm_add_ps(px, _mm_sub_ps(left_c, bottom_s)),  _mm_add_ps(py, _mm_add_ps(left_s, bottom_c)),
+                _mm_add_ps(px, _mm_sub_ps(left_c, top_s)),     _mm_add_ps(py, _mm_add_ps(left_s, top_c)),
+                _mm_add_ps(px, _mm_sub_ps(right_c, top_s)),    _mm_add_ps(py, _mm_add_ps(right_s, top_c)),
+                _mm_add_ps(px, _mm_sub_ps(right_c, bottom_s)), _mm_add_ps(py, _mm_add_ps(right_s, bottom_c)));
+
+        __m128 u0 = _mm_loadu_ps(batch->uv_x + i);
+        __m128 v0 = _mm_loadu_ps(batch->uv_y + i);
+        __m128 u1 = _mm_add_ps(u0, _mm_loadu_ps(batch->uv_w + i));
+        __m128 v1 = _mm_add_ps(v0, _mm_loadu_ps(batch->uv_h + i));
+        store_corners_transposed(uvs, u0, v0, u0, v1, u1, v1, u1, v0);
+
+        for(unsigned int k = 0 ; k < 4 ; k++){
+            __m128 color = batch->color ? _mm_loadu_ps(batch->color + (i + k) * 4) : white;
+            _mm_storeu_ps(colors + k * 16 +  0, color);
+            _mm_storeu_ps(colors + k * 16 +  4, color);
+            _mm_storeu_ps(colors + k * 16 +  8, color);
+            _mm_storeu_ps(colors + k * 16 + 12, color);
+        }
+
+        vertices += 4 * 8;
+        uvs      += 4 * 8;
+        colors   += 4 * 16;
+    }
+}
+
+#endif
+
+void generate_sprite_vertices(
+        const SpriteBatch * batch,
+        unsigned int first,
+        unsigned int count,
+        float * vertices,
+        float * colors,
+        float * uvs,
+        unsigned int * indices,
+        unsigned int base_vertex){
+
+    unsigned int wide_count = 0;
+#if defined(__SSE2__)
+    wide_count = count & ~3u;
+    generate_sprite_vertices_sse(batch, first, wide_count, vertices, colors, uvs);
+#endif
+    generate_sprite_vertices_scalar(batch,
+            first + wide_count,
+            count - wide_count,
+            vertices + wide_count * 8,
+            colors + wide_count * 16,
+            uvs + wide_count * 8);
+
+    for(unsigned int i = 0 ; i < count ; i++){
+        unsigned int base = base_vertex + i * 4;
+        indices[i * 6 + 0] = base + 0;
+        indices[i * 6 + 1] = base + 1;
+        indices[i * 6 + 2] = base + 2;
+        indices[i * 6 + 3] = base + 0;
+        indices[i * 6 + 4] = base + 2;
+        indices[i * 6 + 5] = base + 3;
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SPRITE_BATCH_HH
+#define SPRITE_BATCH_HH
+
+// Bulk sprite submission, sprites are described as structure of arrays so
+// that the vertex kernel can work on 4 sprites per iteration.
+//
+// pos is the center of the sprite, rot is in radians. pivot_x / pivot_y are
+// optional (nullptr rotates around the sprite center) and color is an
+// optional rgba quadruple per sprite (nullptr for white).
+
+struct SpriteBatch{
+    const float * pos_x;
+    const float * pos_y;
+    const float * dim_x;
+    const float * dim_y;
+    const float * rot;
+
+    const float * uv_x;
+    const float * uv_y;
+    const float * uv_w;
+    const float * uv_h;
+
+    const float * pivot_x;
+    const float * pivot_y;
+    const float * color;
+
+    unsigned int count;
+};
+
+// writes count quads (8 vertex floats, 16 color floats, 8 uv floats and
+// 6 indices per sprite) into the given buffers, indices start at base_vertex
+void generate_sprite_vertices(
+        const SpriteBatch * batch,
+        unsigned int first,
+        unsigned int count,
+        float * vertices,
+        float * colors,
+        float * uvs,
+        unsigned int * indices,
+        unsigned int base_vertex);
+
+#endif
@@ -0,0 +1,142 @@
+#include "texture_cache.hh"
+
+#include <stb_image.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// cooked files are named after the fnv-1a hash of the source path
+static void texture_cache_path(const char * source, char * path, size_t size){
+    uint64_t hash = 14695981039346656037ull;
+    for(const char * c = source ; *c ; c++){
+        hash ^= (unsigned char) *c;
+        hash *= 1099511628211ull;
+    }
+    snprintf(path, size, "%s/%016llx.btex", TEXTURE_CACHE_DIRECTORY, (unsigned long long) hash);
+}
+
+static unsigned int mip_dimension(unsigned int size, unsigned int level){
+    unsigned int result = size >> level;
+    return result ? result : 1;
+}
+
+static int texture_cache_cook(const char * source, const char * path){
+    int width, height, component;
+    unsigned char * image = stbi_load(source, &width, &height, &component, 4);
+    if (image == nullptr){
+        printf("texture cache :: failed to decode %s : %s\n", source, stbi_failure_reason());
+        return -1;
+    }
+
+    TextureCacheHeader header = {};
+    header.magic = TEXTURE_CACHE_MAGIC;
+    header.version = TEXTURE_CACHE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.components = 4;
+
+    // only level 0, images are packed into the atlas and never sampled
+    // from their own texture
+    header.mip_count = 1;
+    header.mip_offsets[0] = sizeof(TextureCacheHeader);
+    size_t pixel_size = (size_t) width * height * 4;
+
+    // written next to the final name and renamed, a loader never maps a half
+    // written file
+    char temporary[512];
+    snprintf(temporary, sizeof(temporary), "%s.%d.tmp", path, (int) getpid());
+    mkdir(TEXTURE_CACHE_DIRECTORY, 0755);
+
+    FILE * file = fopen(temporary, "wb");
+    if (file == nullptr){
+        printf("texture cache :: unable to write %s\n", temporary);
+        stbi_image_free(image);
+        return -1;
+    }
+    // header and pixels go straight from stb_image to the file, level 0
+    // directly follows the header
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && fwrite(image, 1, pixel_size, file) == pixel_size;
+    written = fclose(file) == 0 && written;
+    stbi_image_free(image);
+
+    if (written == false || rename(temporary, path) != 0){
+        printf("texture cache :: unable to write %s\n", path);
+        unlink(temporary);
+        return -1;
+    }
+    printf("texture cache :: cooked %s -> %s\n", source, path);
+    return 0;
+}
+
+static int texture_cache_map(const char * path, CookedTexture * texture){
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(TextureCacheHeader)){
+        close(fd);
+        return -1;
+    }
+
+    void * mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return -1;
+
+    const TextureCacheHeader * header = (const TextureCacheHeader *) mapping;
+    bool valid = header->magic == TEXTURE_CACHE_MAGIC 
+        && header->version == TEXTURE_CACHE_VERSION
+        && header->components == 4
+        && header->mip_count > 0 && header->mip_count <= TEXTURE_CACHE_MAX_MIPS;
+
+    for(unsigned int level = 0 ; valid && level < header->mip_count ; level++){
+        uint64_t size = (uint64_t) mip_dimension(header->width, level) * mip_dimension(header->height, level) * 4;
+        valid = header->mip_offsets[level] + size <= (uint64_t) info.st_size;
+    }
+    if (valid == false){
+        munmap(mapping, info.st_size);
+        return -1;
+    }
+
+    texture->mapping = mapping;
+    texture->mapping_size = info.st_size;
+    texture->header = header;
+    return 0;
+}
+
+int texture_cache_load(const char * source, CookedTexture * texture){
+    *texture = {};
+
+    char path[512];
+    texture_cache_path(source, path, sizeof(path));
+
+    struct stat source_info, cache_info;
+    if (stat(source, &source_info) != 0){
+        printf("texture cache :: missing source %s\n", source);
+        return -1;
+    }
+
+    bool stale = stat(path, &cache_info) != 0 || cache_info.st_mtime < source_info.st_mtime;
+    if (stale == false && texture_cache_map(path, texture) == 0) return 0;
+
+    if (texture_cache_cook(source, path)) return -1;
+    return texture_cache_map(path, texture);
+}
+
+void texture_cache_unload(CookedTexture * texture){
+    if (texture->mapping) munmap(texture->mapping, texture->mapping_size);
+    *texture = {};
+}
+
+const unsigned char * texture_cache_mip(const CookedTexture * texture, unsigned int level, unsigned int * width, unsigned int * height){
+    if (texture->header == nullptr || level >= texture->header->mip_count) return nullptr;
+    *width = mip_dimension(texture->header->width, level);
+    *height = mip_dimension(texture->header->height, level);
+    return (const unsigned char *) texture->mapping + texture->header->mip_offsets[level];
+}
@@ -0,0 +1,42 @@
+#ifndef TEXTURE_CACHE_HH
+#define TEXTURE_CACHE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+// Baked texture cache. a source image is cooked once into a gpu ready file,
+// a header followed by the rgba8 pixels (bottom row first like the GL upload
+// expects), and is mmaped on every later load. the file is cooked again when
+// it is missing, unreadable or older than the source.
+//
+// the header has room for a mip chain but only level 0 is cooked, the images
+// end up packed in the atlas and a per image chain would never be sampled
+
+#define TEXTURE_CACHE_DIRECTORY     "texture_cache"
+#define TEXTURE_CACHE_MAGIC         0x58455442      // "BTEX"
+#define TEXTURE_CACHE_VERSION       2
+#define TEXTURE_CACHE_MAX_MIPS      16
+
+struct TextureCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t components;
+    uint32_t mip_count;
+
+    // offset of every level from the start of the file
+    uint64_t mip_offsets[TEXTURE_CACHE_MAX_MIPS];
+};
+
+struct CookedTexture {
+    void * mapping;
+    size_t mapping_size;
+    const TextureCacheHeader * header;
+};
+
+int  texture_cache_load(const char * source, CookedTexture * texture);
+void texture_cache_unload(CookedTexture * texture);
+const unsigned char * texture_cache_mip(const CookedTexture * texture, unsigned int level, unsigned int * width, unsigned int * height);
+
+#endif
@@ -0,0 +1,536 @@
+// Tests and benchmarks for the allocators in src/memory.cc and src/pool.hh,
+// run through ctest or by hand. `memory_test --bench` also times the arena,
+// stack and pool allocators against malloc for the allocation patterns the
+// gamespace has (small per frame temporaries, fixed size object churn)
+
+#include "memory.hh"
+#include "pool.hh"
+#include "containers.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+static unsigned int g_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed : %s\n", __FILE__, __LINE__, #condition); \
+            g_failures += 1; \
+        } \
+    } while(0)
+
+static bool is_aligned(void * ptr, size_t alignment){
+    return ((size_t) ptr % alignment) == 0;
+}
+
+///////////// ARENA /////////////////////////////////////////////////////
+
+static void test_alignment_offset(){
+    char * base = (char *) 0x1000;
+    CHECK(get_alignment_offset(base, 1, 1) == 0);
+    CHECK(get_alignment_offset(base + 1, 4, 4) == 3);
+    CHECK(get_alignment_offset(base + 3, 8, 8) == 5);
+    CHECK(get_alignment_offset(base + 8, 8, 8) == 0);
+    CHECK(get_alignment_offset(base + 1, 64, 64) == 63);
+    CHECK(get_alignment_pointer(base + 5, 16, 16) == base + 16);
+}
+
+static void test_arena_alignment(){
+    alignas(64) static char buffer[KB(4)];
+    MemoryArena arena;
+    init_arena(&arena, buffer + 1, sizeof(buffer) - 1);
+
+    const size_t alignments[] = { 1, 2, 4, 8, 16, 32, 64 };
+    for(size_t alignment : alignments){
+        void * ptr = push_value_to_arena(&arena, 3, alignment);
+        CHECK(ptr != nullptr);
+        CHECK(is_aligned(ptr, alignment));
+    }
+
+    double * values = ALLOCATE_ARRAY(&arena, double, 2 + 1);
+    CHECK(values && is_aligned(values, alignof(double)));
+    CHECK(arena.cur <= arena.size);
+}
+
+static void test_arena_exhaustion(){
+    static char buffer[256];
+    MemoryArena arena;
+    init_arena(&arena, buffer, sizeof(buffer));
+
+    CHECK(push_value_to_arena(&arena, 200, 1) != nullptr);
+    size_t used = arena.cur;
+    CHECK(push_value_to_arena(&arena, 200, 1) == nullptr);
+    // a failed push leaves the arena as it was
+    CHECK(arena.cur == used);
+
+    reset_arena_to_zero(&arena);
+    CHECK(arena.cur == 0);
+    CHECK(push_value_to_arena(&arena, 200, 1) == buffer);
+}
+
+static void test_reserved_arena(){
+    MemoryBlock block = {};
+    CHECK(reserve_memory_block(&block, GB(4), 0) == 0);
+    if (block.ptr == nullptr) return;
+    CHECK(block.flags & MEMORY_RESERVED);
+    CHECK(is_aligned(block.ptr, MEMORY_COMMIT_GRANULARITY));
+
+    MemoryArena arena;
+    init_arena(&arena, block.ptr, block.size, block.flags);
+    CHECK(arena.committed == 0);
+
+    // every push can be written to, the committed range follows the pushes
+    for(unsigned int i = 0 ; i < 8 ; i++){
+        char * ptr = (char *) push_value_to_arena(&arena, MB(1) + 7, 16);
+        CHECK(ptr != nullptr);
+        if (ptr) memset(ptr, 0xab, MB(1) + 7);
+        CHECK(arena.committed >= arena.cur);
+    }
+    CHECK(arena.committed < MB(16));
+
+    release_memory_block(&block);
+    CHECK(block.ptr == nullptr);
+}
+
+///////////// STACK /////////////////////////////////////////////////////
+
+static void test_stack_push_sequence(){
+    // offsets from a null base are the addresses, as in the old main() test
+#ifndef BREAD_MEMORY_GUARDS
+    MemoryStackAllocator stack = {};
+    init_stack_allocator(&stack, nullptr, 10);
+    CHECK(push_in_stack(&stack, 2, 1) == (void *) 0x00);
+    CHECK(push_in_stack(&stack, 4, 4) == (void *) 0x04);
+    MemoryStackMarker marker = get_stack_marker(&stack);
+    CHECK(push_in_stack(&stack, 2, 1) == (void *) 0x08);
+    restore_stack_marker(&stack, marker);
+    CHECK(push_in_stack(&stack, 3, 1) == nullptr);
+    CHECK(stack.used == marker);
+    CHECK(stack.high_water == 10);
+#endif
+}
+
+static void test_stack_markers(){
+    static char buffer[KB(4)];
+    MemoryStackAllocator stack;
+    init_stack_allocator(&stack, buffer, sizeof(buffer));
+
+    MemoryStackMarker start = get_stack_marker(&stack);
+    void * first = push_in_stack(&stack, 100, 8);
+    {
+        STACK_SCOPE(&stack);
+        push_in_stack(&stack, 100, 8);
+        {
+            STACK_SCOPE(&stack);
+            push_in_stack(&stack, 500, 16);
+        }
+        size_t inner = stack.used;
+        push_in_stack(&stack, 1, 1);
+        CHECK(stack.used > inner);
+    }
+    // the scopes gave back everything after the first push
+    CHECK(push_in_stack(&stack, 1, 1) != first);
+    restore_stack_marker(&stack, start);
+    CHECK(stack.used == 0);
+    CHECK(push_in_stack(&stack, 100, 8) == first);
+
+    // restoring a marker above the top does nothing
+    size_t used = stack.used;
+    restore_stack_marker(&stack, used + 64);
+    CHECK(stack.used == used);
+}
+
+static void test_stack_unbounded_pushes(){
+    // the old allocator failed after 128 pushes
+    static char buffer[KB(64)];
+    MemoryStackAllocator stack;
+    init_stack_allocator(&stack, buffer, sizeof(buffer));
+    unsigned int pushed = 0;
+    for(unsigned int i = 0 ; i < 1000 ; i++) pushed += push_in_stack(&stack, 8, 8) != nullptr;
+    CHECK(pushed == 1000);
+}
+
+static void test_stack_frames(){
+    static char buffer[KB(4)];
+    MemoryStackAllocator stack;
+    init_stack_allocator(&stack, buffer, sizeof(buffer));
+
+    push_in_stack(&stack, 1000, 1);
+    begin_stack_frame(&stack);
+    CHECK(stack.used == 0);
+    CHECK(stack.frame_high_water >= 1000);
+    CHECK(stack.peak >= 1000);
+
+    push_in_stack(&stack, 10, 1);
+    begin_stack_frame(&stack);
+    CHECK(stack.frame_high_water < 1000);
+    CHECK(stack.peak >= 1000);
+
+    CHECK(push_in_stack(&stack, sizeof(buffer) + 1, 1) == nullptr);
+    CHECK(stack.used == 0);
+}
+
+#ifdef BREAD_MEMORY_GUARDS
+static void test_guard_bands(){
+    static char buffer[KB(4)];
+    MemoryArena arena;
+    init_arena(&arena, buffer, sizeof(buffer));
+    size_t damaged = memory_stats()->damaged_guards;
+
+    char * first = (char *) push_value_to_arena(&arena, 10, 1);
+    push_value_to_arena(&arena, 10, 8);
+    CHECK(check_arena_guards(&arena) == 0);
+    first[10] = 0;
+    CHECK(check_arena_guards(&arena) == 1);
+
+    MemoryStackAllocator stack;
+    init_stack_allocator(&stack, buffer + KB(2), KB(2));
+    {
+        STACK_SCOPE(&stack);
+        char * temporary = (char *) push_in_stack(&stack, 16, 1);
+        temporary[16] = 0;
+    }
+    CHECK(memory_stats()->damaged_guards == damaged + 2);
+}
+#endif
+
+///////////// ATOMIC ARENA //////////////////////////////////////////////
+
+static void test_atomic_arena(){
+    static char buffer[MB(1)];
+    MemoryAtomicArena arena;
+    CHECK(init_atomic_arena(&arena, buffer + 3, sizeof(buffer) - 3) == 0);
+
+    const unsigned int thread_count = 8;
+    const unsigned int push_count = 2000;
+    std::vector<std::vector<char *>> pushes(thread_count);
+    std::vector<std::thread> threads;
+    for(unsigned int t = 0 ; t < thread_count ; t++){
+        threads.emplace_back([&, t]{
+            for(unsigned int i = 0 ; i < push_count ; i++){
+                char * ptr = PUSH_ATOMIC(&arena, char, 24);
+                if (ptr) memset(ptr, t, 24);
+                pushes[t].push_back(ptr);
+            }
+        });
+    }
+    for(std::thread & thread : threads) thread.join();
+
+    // no two pushes may overlap
+    std::vector<char *> all;
+    for(std::vector<char *> & list : pushes) all.insert(all.end(), list.begin(), list.end());
+    std::sort(all.begin(), all.end());
+    CHECK(all.front() != nullptr);
+    bool overlap = false;
+    for(size_t i = 1 ; i < all.size() ; i++) overlap |= all[i] - all[i - 1] < 24;
+    CHECK(overlap == false);
+
+    CHECK(push_atomic(&arena, sizeof(buffer), 1) == nullptr);
+    reset_atomic_arena(&arena);
+    CHECK(arena.cur == 0);
+    CHECK(arena.frame_high_water == thread_count * push_count * 24);
+}
+
+///////////// POOL //////////////////////////////////////////////////////
+
+struct TestObject {
+    int value;
+};
+
+static void test_pool(){
+    static char buffer[KB(4)];
+    MemoryArena arena;
+    init_arena(&arena, buffer, sizeof(buffer));
+
+    Pool<TestObject> pool;
+    CHECK(init_pool(&pool, &arena, 4) == 0);
+
+    PoolHandle handles[4];
+    for(int i = 0 ; i < 4 ; i++){
+        TestObject * object = nullptr;
+        handles[i] = pool_alloc(&pool, &object);
+        CHECK(handles[i] != POOL_NULL_HANDLE);
+        if (object) object->value = i;
+    }
+    CHECK(pool_alloc(&pool) == POOL_NULL_HANDLE);
+    CHECK(pool_get(&pool, POOL_NULL_HANDLE) == nullptr);
+
+    // freeing keeps the live objects packed and the other handles valid
+    pool_free(&pool, handles[1]);
+    CHECK(pool.count == 3);
+    CHECK(pool_get(&pool, handles[1]) == nullptr);
+    for(int i : { 0, 2, 3 }) CHECK(pool_get(&pool, handles[i]) && pool_get(&pool, handles[i])->value == i);
+    for(uint32_t i = 0 ; i < pool.count ; i++) CHECK(pool_get(&pool, pool_handle(&pool, i)) == pool.items + i);
+
+    // the slot is reused under a new generation
+    PoolHandle reused = pool_alloc(&pool);
+    CHECK(pool_handle_slot(reused) == pool_handle_slot(handles[1]));
+    CHECK(reused != handles[1]);
+    pool_free(&pool, handles[1]);
+    CHECK(pool_get(&pool, reused) != nullptr);
+
+    pool_clear(&pool);
+    CHECK(pool.count == 0);
+    for(int i = 0 ; i < 4 ; i++) CHECK(pool_get(&pool, handles[i]) == nullptr);
+    CHECK(pool_get(&pool, reused) == nullptr);
+
+    // generations wrap without ever producing the null handle
+    PoolHandle handle = pool_alloc(&pool);
+    for(unsigned int i = 0 ; i < 2 * (POOL_GENERATION_MASK + 1) ; i++){
+        pool_free(&pool, handle);
+        handle = pool_alloc(&pool);
+        if (handle == POOL_NULL_HANDLE || pool_handle_generation(handle) == 0) break;
+    }
+    CHECK(handle != POOL_NULL_HANDLE && pool_handle_generation(handle) != 0);
+}
+
+static void test_arrays(){
+    static char buffer[KB(4)];
+    MemoryStackAllocator stack;
+    init_stack_allocator(&stack, buffer, sizeof(buffer));
+
+    FixedArray<int> fixed;
+    CHECK(init_fixed_array(&fixed, container_allocator(&stack), 3) == 0);
+    for(int i = 0 ; i < 3 ; i++) CHECK(fixed_array_push(&fixed, i) != nullptr);
+    CHECK(fixed_array_push(&fixed, 3) == nullptr);
+    fixed_array_remove(&fixed, 0);
+    CHECK(fixed.count == 2 && fixed.items[0] == 2 && fixed.items[1] == 1);
+
+    // the newest allocation grows in place, anything after it forces a copy
+    Array<int> array;
+    init_array(&array, container_allocator(&stack));
+    for(int i = 0 ; i < 100 ; i++) CHECK(array_push(&array, i) != nullptr);
+    CHECK(array.count == 100 && array.capacity >= 100);
+    bool ordered = true;
+    for(int i = 0 ; i < 100 ; i++) ordered = ordered && array.items[i] == i;
+    CHECK(ordered);
+#ifndef BREAD_MEMORY_GUARDS
+    CHECK((char *) array.items + sizeof(int) * array.capacity == (char *) stack.base + stack.used);
+#endif
+    int * before = array.items;
+    PUSH_IN_STACK(&stack, char, 1);
+    array_reserve(&array, array.capacity * 2);
+    CHECK(array.items != before && array.items[99] == 99);
+
+    // running out of memory leaves the array as it was
+    MemoryStackMarker marker = get_stack_marker(&stack);
+    uint32_t count = array.count;
+    CHECK(array_reserve(&array, 100000) == -1);
+    CHECK(array.count == count && array.items[count - 1] == 99);
+    CHECK(stack.used == marker);
+
+    SmallVector<int, 4> small;
+    init_small_vector(&small);
+    for(int i = 0 ; i < 4 ; i++) CHECK(small_vector_push(&small, i) != nullptr);
+    CHECK(small_vector_push(&small, 4) == nullptr);
+    CHECK(small_vector_items(&small) == small.inline_items);
+
+    reset_stack_allocator(&stack);
+    init_small_vector(&small, container_allocator(&stack));
+    for(int i = 0 ; i < 20 ; i++) CHECK(small_vector_push(&small, i) != nullptr);
+    CHECK(small.spilled != nullptr && small_vector_items(&small)[19] == 19 && small_vector_items(&small)[3] == 3);
+}
+
+static void test_hash_map(){
+    static char buffer[KB(64)];
+    MemoryArena arena;
+    init_arena(&arena, buffer, sizeof(buffer));
+
+    HashMap<uint32_t, uint32_t> map;
+    CHECK(init_hash_map(&map, container_allocator(&arena)) == 0);
+    CHECK(hash_map_get(&map, 7u) == nullptr);
+
+    // grows past the initial slots
+    for(uint32_t i = 0 ; i < 1000 ; i++) CHECK(hash_map_put(&map, i * 7919, i) != nullptr);
+    CHECK(map.count == 1000 && map.count * 4 <= map.capacity * 3);
+    bool found = true;
+    for(uint32_t i = 0 ; i < 1000 ; i++) found = found && hash_map_get(&map, i * 7919) && *hash_map_get(&map, i * 7919) == i;
+    CHECK(found);
+
+    CHECK(hash_map_put(&map, 7919u, 42u) != nullptr);
+    CHECK(map.count == 1000 && *hash_map_get(&map, 7919u) == 42);
+
+    // removal keeps every other key reachable
+    for(uint32_t i = 0 ; i < 1000 ; i += 2) CHECK(hash_map_remove(&map, i * 7919));
+    CHECK(hash_map_remove(&map, 0u) == false);
+    CHECK(map.count == 500);
+    bool reachable = true;
+    for(uint32_t i = 0 ; i < 1000 ; i++){
+        bool present = hash_map_get(&map, i * 7919) != nullptr;
+        reachable = reachable && present == (i % 2 == 1);
+    }
+    CHECK(reachable);
+
+    uint32_t used = 0;
+    for(uint32_t i = 0 ; i < map.capacity ; i++) used += map.used[i];
+    CHECK(used == map.count);
+
+    hash_map_clear(&map);
+    CHECK(map.count == 0 && hash_map_get(&map, 7919u) == nullptr);
+}
+
+///////////// BENCHMARKS ////////////////////////////////////////////////
+
+#define BENCH_FRAMES            200
+#define BENCH_PUSHES_PER_FRAME  4096
+#define BENCH_POOL_OBJECTS      4096
+
+static volatile size_t g_sink = 0;
+
+static uint64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char * name, uint64_t elapsed, size_t operations){
+    printf("  %-28s %8.2f ns/op\n", name, (double) elapsed / operations);
+}
+
+// sizes of typical temporaries, between 16 and 1024 bytes
+static void bench_sizes(size_t * sizes, unsigned int count){
+    uint32_t state = 0x12345678;
+    for(unsigned int i = 0 ; i < count ; i++){
+        state = state * 1664525u + 1013904223u;
+        sizes[i] = 16 + (state >> 16) % 1008;
+    }
+}
+
+static void bench_frame_temporaries(){
+    static size_t sizes[BENCH_PUSHES_PER_FRAME];
+    bench_sizes(sizes, BENCH_PUSHES_PER_FRAME);
+    const size_t operations = (size_t) BENCH_FRAMES * BENCH_PUSHES_PER_FRAME;
+
+    char * buffer = (char *) malloc(MB(8));
+    printf("frame temporaries (%u pushes per frame, released at frame end)\n", BENCH_PUSHES_PER_FRAME);
+
+    MemoryArena arena;
+    init_arena(&arena, buffer, MB(8));
+    uint64_t begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        for(unsigned int i = 0 ; i < BENCH_PUSHES_PER_FRAME ; i++){
+            g_sink += (size_t) push_value_to_arena(&arena, sizes[i], 8);
+        }
+        reset_arena_to_zero(&arena);
+    }
+    report("arena push + reset", now_ns() - begin, operations);
+
+    MemoryStackAllocator stack;
+    init_stack_allocator(&stack, buffer, MB(8));
+    begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        for(unsigned int i = 0 ; i < BENCH_PUSHES_PER_FRAME ; i++){
+            g_sink += (size_t) push_in_stack(&stack, sizes[i], 8);
+        }
+        begin_stack_frame(&stack);
+    }
+    report("stack push + frame reset", now_ns() - begin, operations);
+
+    begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        for(unsigned int i = 0 ; i < BENCH_PUSHES_PER_FRAME ; i += 4){
+            STACK_SCOPE(&stack);
+            for(unsigned int j = i ; j < i + 4 ; j++) g_sink += (size_t) push_in_stack(&stack, sizes[j], 8);
+        }
+    }
+    report("stack push + scope release", now_ns() - begin, operations);
+
+    static void * pointers[BENCH_PUSHES_PER_FRAME];
+    begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        for(unsigned int i = 0 ; i < BENCH_PUSHES_PER_FRAME ; i++){
+            pointers[i] = malloc(sizes[i]);
+            g_sink += (size_t) pointers[i];
+        }
+        for(unsigned int i = 0 ; i < BENCH_PUSHES_PER_FRAME ; i++) free(pointers[i]);
+    }
+    report("malloc + free", now_ns() - begin, operations);
+
+    free(buffer);
+}
+
+struct BenchObject {
+    float pos[2];
+    float dim[2];
+    float velocity[2];
+    unsigned int properties;
+};
+
+static void bench_object_churn(){
+    const size_t operations = (size_t) BENCH_FRAMES * BENCH_POOL_OBJECTS;
+    printf("object churn (%u live objects, a quarter replaced per frame)\n", BENCH_POOL_OBJECTS);
+
+    char * buffer = (char *) malloc(MB(1));
+    MemoryArena arena;
+    init_arena(&arena, buffer, MB(1));
+    Pool<BenchObject> pool;
+    init_pool(&pool, &arena, BENCH_POOL_OBJECTS);
+
+    static PoolHandle handles[BENCH_POOL_OBJECTS];
+    for(unsigned int i = 0 ; i < BENCH_POOL_OBJECTS ; i++) handles[i] = pool_alloc(&pool);
+
+    uint64_t begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        for(unsigned int i = frame % 4 ; i < BENCH_POOL_OBJECTS ; i += 4){
+            pool_free(&pool, handles[i]);
+            handles[i] = pool_alloc(&pool);
+        }
+        for(uint32_t i = 0 ; i < pool.count ; i++) pool.items[i].pos[0] += pool.items[i].velocity[0];
+    }
+    report("pool replace + dense update", now_ns() - begin, operations);
+
+    static BenchObject * objects[BENCH_POOL_OBJECTS];
+    for(unsigned int i = 0 ; i < BENCH_POOL_OBJECTS ; i++) objects[i] = (BenchObject *) calloc(1, sizeof(BenchObject));
+    begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        for(unsigned int i = frame % 4 ; i < BENCH_POOL_OBJECTS ; i += 4){
+            free(objects[i]);
+            objects[i] = (BenchObject *) calloc(1, sizeof(BenchObject));
+        }
+        for(unsigned int i = 0 ; i < BENCH_POOL_OBJECTS ; i++) objects[i]->pos[0] += objects[i]->velocity[0];
+    }
+    report("malloc replace + update", now_ns() - begin, operations);
+    for(unsigned int i = 0 ; i < BENCH_POOL_OBJECTS ; i++) free(objects[i]);
+
+    free(buffer);
+}
+
+int main(int argc, char ** argv){
+    bool bench = false;
+    for(int i = 1 ; i < argc ; i++){
+        if (strcmp(argv[i], "--bench") == 0) bench = true;
+    }
+
+    test_alignment_offset();
+    test_arena_alignment();
+    test_arena_exhaustion();
+    test_reserved_arena();
+    test_stack_push_sequence();
+    test_stack_markers();
+    test_stack_unbounded_pushes();
+    test_stack_frames();
+#ifdef BREAD_MEMORY_GUARDS
+    test_guard_bands();
+#endif
+    test_atomic_arena();
+    test_pool();
+    test_arrays();
+    test_hash_map();
+
+    if (g_failures){
+        printf("memory test : %u checks failed\n", g_failures);
+        return 1;
+    }
+    printf("memory test : all checks passed\n");
+
+    if (bench){
+        bench_frame_temporaries();
+        bench_object_churn();
+    }
+    return 0;
+}
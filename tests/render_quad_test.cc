@@ -0,0 +1,422 @@
+// Checks and benchmark for the quad emitters in src/quad_emitter.hh, run
+// through ctest or by hand. the render_quad_rect functions they replaced are
+// kept here as the reference, every template variant has to fill the buffers
+// the same way as the function it took over from. `render_quad_test --bench`
+// times both of them on a full renderer worth of quads
+
+#include "gamespace.hh"
+#include "quad_emitter.hh"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+
+static unsigned int g_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed : %s\n", __FILE__, __LINE__, #condition); \
+            g_failures += 1; \
+        } \
+    } while(0)
+
+// same as QUADCOUNT in gamespace.cc
+#define TEST_QUADS      20000
+#define BENCH_FRAMES    200
+
+///////////// REFERENCE /////////////////////////////////////////////////
+
+// the emitters as they were before render_quad<FEATURES>
+
+static void render_quad_rect_tex_rot(
+        Renderer2D * renderer,
+        glm::vec2 pos,
+        glm::vec2 dim,
+        glm::vec4 color,
+        glm::vec2 uv_pos,
+        glm::vec2 uv_dim,
+        glm::vec2 center,
+        float rot){
+    if (
+            renderer->added_vertices >= renderer->total_vertices
+            || renderer->added_colors >= renderer->total_colors
+            || renderer->added_indices >= renderer->total_indices
+       ){
+        printf("renderer :: buffer entirly full\n");
+        return;
+    }
+
+    glm::vec2 rect[4];
+    rect[0] = glm::vec2(pos.x, pos.y);
+    rect[1] = glm::vec2(pos.x, pos.y + dim.y);
+    rect[2] = glm::vec2(pos.x + dim.x, pos.y + dim.y);
+    rect[3] = glm::vec2(pos.x + dim.x, pos.y);
+
+    glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), rot, glm::vec3(0.0f, 0.0f, 1.0f));
+
+    for(unsigned int i = 0; i < 4 ; i++){
+        rect[i] = center + glm::vec2(rotation_matrix *  glm::vec4((rect[i] - center), 0.0, 1.0));
+    }
+
+    glm::vec4 colors[4] = { color,color,color,color };
+
+    glm::vec2 uv[4];
+    uv[0] = glm::vec2(uv_pos.x, uv_pos.y);
+    uv[1] = glm::vec2(uv_pos.x, uv_pos.y + uv_dim.y);
+    uv[2] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y + uv_dim.y);
+    uv[3] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y);
+
+    unsigned int indices[6] = {
+        0 + (unsigned int) renderer->added_vertices / 2,
+        1 + (unsigned int) renderer->added_vertices / 2,
+        2 + (unsigned int) renderer->added_vertices / 2,
+        0 + (unsigned int) renderer->added_vertices / 2,
+        2 + (unsigned int) renderer->added_vertices / 2,
+        3 + (unsigned int) renderer->added_vertices / 2,
+    };
+
+    memcpy(renderer->mem_vertex_buffer + renderer->added_vertices, rect,  sizeof(float) * 2 * 4);
+    renderer->added_vertices += 2 * 4;
+
+    memcpy(renderer->mem_color_buffer + renderer->added_colors, colors, sizeof(float) * 4 * 4);
+    renderer->added_colors += 4 * 4;
+
+    memcpy(renderer->mem_uv_coord_buffer + renderer->added_uv_coords, uv, sizeof(float) * 2 * 4);
+    renderer->added_uv_coords += 2 * 4;
+
+    memcpy(renderer->mem_index_buffer + renderer->added_indices, indices, sizeof(unsigned int) * 6);
+    renderer->added_indices += 6;
+}
+
+static void render_quad_rect_tex(
+        Renderer2D * renderer,
+        glm::vec2 pos,
+        glm::vec2 dim,
+        glm::vec4 color,
+        glm::vec2 uv_pos,
+        glm::vec2 uv_dim
+        ){
+    if (
+            renderer->added_vertices >= renderer->total_vertices
+            || renderer->added_colors >= renderer->total_colors
+            || renderer->added_indices >= renderer->total_indices
+       ){
+        printf("renderer :: buffer entirly full\n");
+        return;
+    }
+
+    glm::vec2 rect[4];
+    rect[0] = glm::vec2(pos.x, pos.y);
+    rect[1] = glm::vec2(pos.x, pos.y + dim.y);
+    rect[2] = glm::vec2(pos.x + dim.x, pos.y + dim.y);
+    rect[3] = glm::vec2(pos.x + dim.x, pos.y);
+
+    glm::vec4 colors[4] = { color,color,color,color };
+
+    glm::vec2 uv[4];
+    uv[0] = glm::vec2(uv_pos.x, uv_pos.y);
+    uv[1] = glm::vec2(uv_pos.x, uv_pos.y + uv_dim.y);
+    uv[2] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y + uv_dim.y);
+    uv[3] = glm::vec2(uv_pos.x + uv_dim.x, uv_pos.y);
+
+    unsigned int indices[6] = {
+        0 + (unsigned int) renderer->added_vertices / 2,
+        1 + (unsigned int) renderer->added_vertices / 2,
+        2 + (unsigned int) renderer->added_vertices / 2,
+        0 + (unsigned int) renderer->added_vertices / 2,
+        2 + (unsigned int) renderer->added_vertices / 2,
+        3 + (unsigned int) renderer->added_vertices / 2,
+    };
+
+    memcpy(renderer->mem_vertex_buffer + renderer->added_vertices, rect,  sizeof(float) * 2 * 4);
+    renderer->added_vertices += 2 * 4;
+
+    memcpy(renderer->mem_color_buffer + renderer->added_colors, colors, sizeof(float) * 4 * 4);
+    renderer->added_colors += 4 * 4;
+
+    memcpy(renderer->mem_uv_coord_buffer + renderer->added_uv_coords, uv, sizeof(float) * 2 * 4);
+    renderer->added_uv_coords += 2 * 4;
+
+    memcpy(renderer->mem_index_buffer + renderer->added_indices, indices, sizeof(unsigned int) * 6);
+    renderer->added_indices += 6;
+}
+
+static void render_quad_rect(Renderer2D * renderer, glm::vec2 pos, glm::vec2 dim, glm::vec4 color){
+    if (
+            renderer->added_vertices >= renderer->total_vertices
+            || renderer->added_colors >= renderer->total_colors
+            || renderer->added_indices >= renderer->total_indices
+       ){
+        printf("renderer; buffer entirely full\n");
+        return;
+    }
+
+    glm::vec2 rect[4];
+    rect[0] = glm::vec2(pos.x, pos.y);
+    rect[1] = glm::vec2(pos.x, pos.y + dim.y);
+    rect[2] = glm::vec2(pos.x + dim.x, pos.y + dim.y);
+    rect[3] = glm::vec2(pos.x + dim.x, pos.y);
+
+    glm::vec4 colors[4] = { color,color,color,color };
+
+    unsigned int indices[6] = {
+        0 + (unsigned int) renderer->added_vertices / 2,
+        1 + (unsigned int) renderer->added_vertices / 2,
+        2 + (unsigned int) renderer->added_vertices / 2,
+        0 + (unsigned int) renderer->added_vertices / 2,
+        2 + (unsigned int) renderer->added_vertices / 2,
+        3 + (unsigned int) renderer->added_vertices / 2,
+    };
+
+    memcpy(renderer->mem_vertex_buffer + renderer->added_vertices, rect,  sizeof(float) * 2 * 4);
+    renderer->added_vertices += 2 * 4;
+
+    memcpy(renderer->mem_color_buffer + renderer->added_colors, colors, sizeof(float) * 4 * 4);
+    renderer->added_colors += 4 * 4;
+
+    memcpy(renderer->mem_index_buffer + renderer->added_indices, indices, sizeof(unsigned int) * 6);
+    renderer->added_indices += 6;
+}
+
+///////////// HELPERS ///////////////////////////////////////////////////
+
+struct QuadInput {
+    glm::vec2 pos;
+    glm::vec2 dim;
+    glm::vec4 color;
+    glm::vec2 uv_pos;
+    glm::vec2 uv_dim;
+    glm::vec2 center;
+    float rot;
+};
+
+static float random_float(uint32_t * state, float min, float max){
+    *state = *state * 1664525u + 1013904223u;
+    return min + (max - min) * (float) (*state >> 8) / (float) (1u << 24);
+}
+
+// quads spread over a 1200x900 window, as the game draws them
+static void make_inputs(QuadInput * inputs, unsigned int count){
+    uint32_t state = 0x12345678;
+    for(unsigned int i = 0 ; i < count ; i++){
+        QuadInput * input = inputs + i;
+        input->pos    = glm::vec2(random_float(&state, 0.0f, 1200.0f), random_float(&state, 0.0f, 900.0f));
+        input->dim    = glm::vec2(random_float(&state, 1.0f, 64.0f), random_float(&state, 1.0f, 64.0f));
+        input->color  = glm::vec4(random_float(&state, 0.0f, 1.0f), random_float(&state, 0.0f, 1.0f), random_float(&state, 0.0f, 1.0f), 1.0f);
+        input->uv_pos = glm::vec2(random_float(&state, 0.0f, 0.9f), random_float(&state, 0.0f, 0.9f));
+        input->uv_dim = glm::vec2(0.0625f, 0.0625f);
+        input->center = input->pos + input->dim * 0.5f;
+        input->rot    = random_float(&state, -3.14159f, 3.14159f);
+    }
+}
+
+static void init_test_renderer(Renderer2D * renderer, size_t quad_count){
+    *renderer = {};
+    renderer->mem_vertex_buffer   = (float *) calloc(quad_count * 8, sizeof(float));
+    renderer->mem_uv_coord_buffer = (float *) calloc(quad_count * 8, sizeof(float));
+    renderer->mem_color_buffer    = (float *) calloc(quad_count * 16, sizeof(float));
+    renderer->mem_index_buffer    = (unsigned int *) calloc(quad_count * 6, sizeof(unsigned int));
+    renderer->total_vertices  = quad_count * 8;
+    renderer->total_uv_coords = quad_count * 8;
+    renderer->total_colors    = quad_count * 16;
+    renderer->total_indices   = quad_count * 6;
+}
+
+static void free_test_renderer(Renderer2D * renderer){
+    free(renderer->mem_vertex_buffer);
+    free(renderer->mem_uv_coord_buffer);
+    free(renderer->mem_color_buffer);
+    free(renderer->mem_index_buffer);
+    *renderer = {};
+}
+
+static void clear_test_renderer(Renderer2D * renderer){
+    renderer->added_vertices = 0;
+    renderer->added_uv_coords = 0;
+    renderer->added_colors = 0;
+    renderer->added_indices = 0;
+}
+
+static bool floats_match(const float * a, const float * b, size_t count, float epsilon){
+    for(size_t i = 0 ; i < count ; i++){
+        if (fabsf(a[i] - b[i]) > epsilon) return false;
+    }
+    return true;
+}
+
+///////////// CHECKS ////////////////////////////////////////////////////
+
+#define CHECK_QUADS     1024
+
+static void test_colored(const QuadInput * inputs){
+    Renderer2D reference, emitter;
+    init_test_renderer(&reference, CHECK_QUADS);
+    init_test_renderer(&emitter, CHECK_QUADS);
+
+    for(unsigned int i = 0 ; i < CHECK_QUADS ; i++){
+        render_quad_rect(&reference, inputs[i].pos, inputs[i].dim, inputs[i].color);
+        render_quad<QUAD_COLORED>(&emitter, inputs[i].pos, inputs[i].dim, inputs[i].color);
+    }
+    CHECK(emitter.added_vertices == reference.added_vertices);
+    CHECK(emitter.added_colors == reference.added_colors);
+    CHECK(emitter.added_indices == reference.added_indices);
+    CHECK(memcmp(emitter.mem_vertex_buffer, reference.mem_vertex_buffer, sizeof(float) * CHECK_QUADS * 8) == 0);
+    CHECK(memcmp(emitter.mem_color_buffer, reference.mem_color_buffer, sizeof(float) * CHECK_QUADS * 16) == 0);
+    CHECK(memcmp(emitter.mem_index_buffer, reference.mem_index_buffer, sizeof(unsigned int) * CHECK_QUADS * 6) == 0);
+
+    // the old function left the uv buffer behind, the emitter keeps it in
+    // step with the full (0,0)-(1,1) range
+    CHECK(reference.added_uv_coords == 0);
+    CHECK(emitter.added_uv_coords == emitter.added_vertices);
+    const float full_uv[8] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f };
+    CHECK(memcmp(emitter.mem_uv_coord_buffer + (CHECK_QUADS - 1) * 8, full_uv, sizeof(full_uv)) == 0);
+
+    free_test_renderer(&reference);
+    free_test_renderer(&emitter);
+}
+
+static void test_textured(const QuadInput * inputs){
+    Renderer2D reference, emitter;
+    init_test_renderer(&reference, CHECK_QUADS);
+    init_test_renderer(&emitter, CHECK_QUADS);
+
+    for(unsigned int i = 0 ; i < CHECK_QUADS ; i++){
+        const QuadInput * in = inputs + i;
+        render_quad_rect_tex(&reference, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim);
+        render_quad<QUAD_COLORED | QUAD_TEXTURED>(&emitter, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim);
+    }
+    CHECK(emitter.added_vertices == reference.added_vertices);
+    CHECK(emitter.added_uv_coords == reference.added_uv_coords);
+    CHECK(emitter.added_colors == reference.added_colors);
+    CHECK(emitter.added_indices == reference.added_indices);
+    CHECK(memcmp(emitter.mem_vertex_buffer, reference.mem_vertex_buffer, sizeof(float) * CHECK_QUADS * 8) == 0);
+    CHECK(memcmp(emitter.mem_uv_coord_buffer, reference.mem_uv_coord_buffer, sizeof(float) * CHECK_QUADS * 8) == 0);
+    CHECK(memcmp(emitter.mem_color_buffer, reference.mem_color_buffer, sizeof(float) * CHECK_QUADS * 16) == 0);
+    CHECK(memcmp(emitter.mem_index_buffer, reference.mem_index_buffer, sizeof(unsigned int) * CHECK_QUADS * 6) == 0);
+
+    free_test_renderer(&reference);
+    free_test_renderer(&emitter);
+}
+
+static void test_rotated(const QuadInput * inputs){
+    Renderer2D reference, emitter;
+    init_test_renderer(&reference, CHECK_QUADS);
+    init_test_renderer(&emitter, CHECK_QUADS);
+
+    for(unsigned int i = 0 ; i < CHECK_QUADS ; i++){
+        const QuadInput * in = inputs + i;
+        render_quad_rect_tex_rot(&reference, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim, in->center, in->rot);
+        render_quad<QUAD_COLORED | QUAD_TEXTURED | QUAD_ROTATED>(&emitter, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim, in->center, in->rot);
+    }
+    CHECK(emitter.added_vertices == reference.added_vertices);
+    CHECK(emitter.added_indices == reference.added_indices);
+    // the 2x2 rotation rounds differently from the 4x4 matrix, positions are
+    // up to 1200 so a few float ulps there are well below a pixel
+    CHECK(floats_match(emitter.mem_vertex_buffer, reference.mem_vertex_buffer, CHECK_QUADS * 8, 1e-3f));
+    CHECK(memcmp(emitter.mem_uv_coord_buffer, reference.mem_uv_coord_buffer, sizeof(float) * CHECK_QUADS * 8) == 0);
+    CHECK(memcmp(emitter.mem_color_buffer, reference.mem_color_buffer, sizeof(float) * CHECK_QUADS * 16) == 0);
+    CHECK(memcmp(emitter.mem_index_buffer, reference.mem_index_buffer, sizeof(unsigned int) * CHECK_QUADS * 6) == 0);
+
+    free_test_renderer(&reference);
+    free_test_renderer(&emitter);
+}
+
+static void test_full_renderer(const QuadInput * inputs){
+    Renderer2D emitter;
+    init_test_renderer(&emitter, 2);
+    for(unsigned int i = 0 ; i < 3 ; i++){
+        render_quad<QUAD_COLORED>(&emitter, inputs[i].pos, inputs[i].dim, inputs[i].color);
+    }
+    CHECK(emitter.added_indices == 2 * 6);
+    CHECK(emitter.added_vertices == 2 * 8);
+    free_test_renderer(&emitter);
+}
+
+///////////// BENCHMARK /////////////////////////////////////////////////
+
+static volatile size_t g_sink = 0;
+
+static uint64_t now_ns(){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char * name, uint64_t elapsed, size_t operations){
+    printf("  %-36s %8.2f ns/quad\n", name, (double) elapsed / operations);
+}
+
+// fills the renderer with every input once per frame, after one untimed
+// frame so that first touch page faults are not counted
+template<typename EMIT>
+static void time_quads(const char * name, Renderer2D * renderer, const QuadInput * inputs, EMIT emit){
+    clear_test_renderer(renderer);
+    for(unsigned int i = 0 ; i < TEST_QUADS ; i++) emit(renderer, inputs + i);
+
+    uint64_t begin = now_ns();
+    for(unsigned int frame = 0 ; frame < BENCH_FRAMES ; frame++){
+        clear_test_renderer(renderer);
+        for(unsigned int i = 0 ; i < TEST_QUADS ; i++) emit(renderer, inputs + i);
+        g_sink += renderer->mem_index_buffer[renderer->added_indices - 1];
+    }
+    report(name, now_ns() - begin, (size_t) BENCH_FRAMES * TEST_QUADS);
+}
+
+static void bench_quads(const QuadInput * inputs){
+    Renderer2D renderer;
+    init_test_renderer(&renderer, TEST_QUADS);
+    printf("quad emitters (%u quads per frame, %u frames)\n", TEST_QUADS, BENCH_FRAMES);
+
+    time_quads("render_quad_rect", &renderer, inputs, [](Renderer2D * r, const QuadInput * in){
+        render_quad_rect(r, in->pos, in->dim, in->color);
+    });
+    time_quads("render_quad<COLORED>", &renderer, inputs, [](Renderer2D * r, const QuadInput * in){
+        render_quad<QUAD_COLORED>(r, in->pos, in->dim, in->color);
+    });
+    time_quads("render_quad_rect_tex", &renderer, inputs, [](Renderer2D * r, const QuadInput * in){
+        render_quad_rect_tex(r, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim);
+    });
+    time_quads("render_quad<COLORED|TEXTURED>", &renderer, inputs, [](Renderer2D * r, const QuadInput * in){
+        render_quad<QUAD_COLORED | QUAD_TEXTURED>(r, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim);
+    });
+    time_quads("render_quad_rect_tex_rot", &renderer, inputs, [](Renderer2D * r, const QuadInput * in){
+        render_quad_rect_tex_rot(r, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim, in->center, in->rot);
+    });
+    time_quads("render_quad<COLORED|TEXTURED|ROTATED>", &renderer, inputs, [](Renderer2D * r, const QuadInput * in){
+        render_quad<QUAD_COLORED | QUAD_TEXTURED | QUAD_ROTATED>(r, in->pos, in->dim, in->color, in->uv_pos, in->uv_dim, in->center, in->rot);
+    });
+
+    free_test_renderer(&renderer);
+}
+
+int main(int argc, char ** argv){
+    bool bench = false;
+    for(int i = 1 ; i < argc ; i++){
+        if (strcmp(argv[i], "--bench") == 0) bench = true;
+    }
+
+    QuadInput * inputs = (QuadInput *) malloc(sizeof(QuadInput) * TEST_QUADS);
+    make_inputs(inputs, TEST_QUADS);
+
+    test_colored(inputs);
+    test_textured(inputs);
+    test_rotated(inputs);
+    test_full_renderer(inputs);
+
+    if (g_failures){
+        printf("render quad test : %u checks failed\n", g_failures);
+        free(inputs);
+        return 1;
+    }
+    printf("render quad test : all checks passed\n");
+
+    if (bench) bench_quads(inputs);
+    free(inputs);
+    return 0;
+}